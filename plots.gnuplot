@@ -19,7 +19,13 @@ do for [data in "m3killer organpipe random random01 rotated sorted"] {
     plot input using (column("nth_element")/column("nth_element")):xticlabels(xlabel($1)) title "GNUIntroselect", \
         input using (column("nth_element")/column("rnd3pivot")):xticlabels(xlabel($1)) title "RND3Pivot", \
         input using (column("nth_element")/column("ninther")):xticlabels(xlabel($1)) title "Ninther", \
-        input using (column("nth_element")/column("median_of_ninthers")):xticlabels(xlabel($1)) title "QuickselectAdaptive"
+        input using (column("nth_element")/column("median_of_ninthers")):xticlabels(xlabel($1)) title "QuickselectAdaptive", \
+        input using (column("nth_element")/column("median_of_ninthers_block")):xticlabels(xlabel($1)) title "QuickselectAdaptiveBlock", \
+        input using (column("nth_element")/column("median_of_ninthers_simd")):xticlabels(xlabel($1)) title "QuickselectAdaptiveSIMD", \
+        input using (column("nth_element")/column("median_of_ninthers_gathered")):xticlabels(xlabel($1)) title "QuickselectAdaptiveGathered", \
+        input using (column("nth_element")/column("median_of_ninthers_parallel")):xticlabels(xlabel($1)) title "QuickselectAdaptiveParallel", \
+        input using (column("nth_element")/column("floyd_rivest")):xticlabels(xlabel($1)) title "FloydRivest", \
+        input using (column("nth_element")/column("radix_select")):xticlabels(xlabel($1)) title "RadixSelect"
 }
 
 set title "Speedup relative to GNUIntroselect (googlebooks dataset)"
@@ -28,4 +34,10 @@ set output "plots/gbooks_freq.svg"
 plot input using (column("nth_element")/column("nth_element")):xticlabels(1) title "GNUIntroselect", \
     input using (column("nth_element")/column("rnd3pivot")):xticlabels(1) title "RND3Pivot", \
     input using (column("nth_element")/column("ninther")):xticlabels(1) title "Ninther", \
-    input using (column("nth_element")/column("median_of_ninthers")):xticlabels(1) title "QuickselectAdaptive"
+    input using (column("nth_element")/column("median_of_ninthers")):xticlabels(1) title "QuickselectAdaptive", \
+    input using (column("nth_element")/column("median_of_ninthers_block")):xticlabels(1) title "QuickselectAdaptiveBlock", \
+    input using (column("nth_element")/column("median_of_ninthers_simd")):xticlabels(1) title "QuickselectAdaptiveSIMD", \
+    input using (column("nth_element")/column("median_of_ninthers_gathered")):xticlabels(1) title "QuickselectAdaptiveGathered", \
+    input using (column("nth_element")/column("median_of_ninthers_parallel")):xticlabels(1) title "QuickselectAdaptiveParallel", \
+    input using (column("nth_element")/column("floyd_rivest")):xticlabels(1) title "FloydRivest", \
+    input using (column("nth_element")/column("radix_select")):xticlabels(1) title "RadixSelect"
@@ -0,0 +1,30 @@
+set term svg mouse standalone size 800, 600
+set boxwidth 0.9 relative
+set style data histogram
+set style histogram clustered
+set style fill solid 1.0 border lt -1
+set xlabel "Input size"
+set yrange [0:]
+set grid noxtics ytics
+set key outside
+
+xlabel(n) = gprintf("%.2t · 10^{%T}", n)
+
+do for [counter in "instructions cycles branch_misses l1d_misses llc_misses dtlb_misses"] {
+    set ylabel counter . " per element"
+    do for [data in "m3killer organpipe random random01 rotated sorted"] {
+        set title counter . " per element (" . data . " dataset)"
+        input = "results/" . data . "." . counter
+        set output "plots/" . data . "_" . counter . ".svg"
+        plot input using (column("nth_element")):xticlabels(xlabel($1)) title "GNUIntroselect", \
+            input using (column("rnd3pivot")):xticlabels(xlabel($1)) title "RND3Pivot", \
+            input using (column("ninther")):xticlabels(xlabel($1)) title "Ninther", \
+            input using (column("median_of_ninthers")):xticlabels(xlabel($1)) title "QuickselectAdaptive", \
+            input using (column("median_of_ninthers_block")):xticlabels(xlabel($1)) title "QuickselectAdaptiveBlock", \
+            input using (column("median_of_ninthers_simd")):xticlabels(xlabel($1)) title "QuickselectAdaptiveSIMD", \
+            input using (column("median_of_ninthers_gathered")):xticlabels(xlabel($1)) title "QuickselectAdaptiveGathered", \
+            input using (column("median_of_ninthers_parallel")):xticlabels(xlabel($1)) title "QuickselectAdaptiveParallel", \
+            input using (column("floyd_rivest")):xticlabels(xlabel($1)) title "FloydRivest", \
+            input using (column("radix_select")):xticlabels(xlabel($1)) title "RadixSelect"
+    }
+}
@@ -0,0 +1,128 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+// All algorithms of the benchmarks in one program, for tools that run several
+// of them on keys of any type. Must be included first, by one translation
+// unit only, which also defines the counters of common.h.
+
+#pragma once
+// Included first as it requires, and so that the algorithm files below find
+// their headers already included
+#include "instrumented_double.h"
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "const_select.h"
+#include "generate.h"
+#include "out_of_core.h"
+#include "parallel_select.h"
+
+// Each algorithm's source, which defines computeSelection (and possibly other
+// hooks of main.cpp) for its own binary, compiled into a namespace of its own.
+// The templates behind computeSelection are instantiated below for each type.
+namespace algo_nth_element {
+#include "nth_element.cpp"
+}
+namespace algo_median_of_ninthers {
+#include "median_of_ninthers.cpp"
+}
+namespace algo_median_of_ninthers_block {
+#include "median_of_ninthers_block.cpp"
+}
+namespace algo_median_of_ninthers_simd {
+#include "median_of_ninthers_simd.cpp"
+}
+namespace algo_median_of_ninthers_gathered {
+#include "median_of_ninthers_gathered.cpp"
+}
+namespace algo_median_of_ninthers_parallel {
+#include "median_of_ninthers_parallel.cpp"
+}
+namespace algo_floyd_rivest {
+#include "floyd_rivest.cpp"
+}
+namespace algo_radix_select {
+#include "radix_select.cpp"
+}
+namespace algo_rnd3pivot {
+#include "rnd3pivot.cpp"
+}
+namespace algo_ninther {
+#include "ninther.cpp"
+}
+namespace algo_bfprt_baseline {
+#include "bfprt_baseline.cpp"
+}
+
+template <class T>
+struct Algorithm
+{
+    const char* name;
+    void (*select)(T*, T*, T*);
+};
+
+template <class T>
+void addRadixSelect(std::vector<Algorithm<T>>& result, std::true_type)
+{
+    result.push_back({ "radix_select", &algo_radix_select::quickselect<T> });
+}
+
+template <class T>
+void addRadixSelect(std::vector<Algorithm<T>>&, std::false_type)
+{
+    // Radix selection needs arithmetic keys
+}
+
+// All algorithms that apply to keys of type T, in the order of ALGOS in the
+// Makefile. For double, these are the functions computeSelection points to,
+// except that nth_element isn't wrapped for counting comparisons.
+template <class T>
+std::vector<Algorithm<T>> algorithms()
+{
+    std::vector<Algorithm<T>> result =
+    {
+        { "nth_element", &std::nth_element<T*> },
+        { "median_of_ninthers", &algo_median_of_ninthers::quickselect<T> },
+        { "median_of_ninthers_block",
+            &algo_median_of_ninthers_block::quickselect<T> },
+        { "median_of_ninthers_simd",
+            &algo_median_of_ninthers_simd::quickselect<T> },
+        { "median_of_ninthers_gathered",
+            &algo_median_of_ninthers_gathered::quickselect<T> },
+        { "median_of_ninthers_parallel",
+            &algo_median_of_ninthers_parallel::quickselect<T> },
+        { "floyd_rivest", &algo_floyd_rivest::quickselect<T> },
+    };
+    addRadixSelect(result, UsesRadixSelect<T*, std::less<>>());
+    result.push_back({ "rnd3pivot",
+        &quickselect<T, &algo_rnd3pivot::partition<T>> });
+    result.push_back({ "ninther",
+        &quickselect<T, &algo_ninther::partition<T>> });
+    result.push_back({ "bfprt_baseline",
+        &quickselect<T, &algo_bfprt_baseline::partition<T>> });
+    return result;
+}
+
+// The algorithm named name among algorithms<T>(), or one with a null select if
+// there is none
+template <class T>
+Algorithm<T> findAlgorithm(const std::string& name)
+{
+    for (const auto& a : algorithms<T>())
+        if (name == a.name) return a;
+    return { nullptr, nullptr };
+}
+
+// Builds in out[0 .. length] the antiqsort input for the median selection of
+// the named algorithm. Returns the number of comparisons the algorithm made
+// while building it, or 0 if there's no such algorithm.
+inline size_t antiqsortFor(const std::string& name, double* out,
+    size_t length)
+{
+    const auto a = findAlgorithm<AdversaryKey>(name);
+    if (!a.select || length == 0) return 0;
+    return antiqsort(out, length, length / 2, a.select);
+}
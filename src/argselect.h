@@ -0,0 +1,87 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include "median_of_ninthers.h"
+
+/**
+Compares indices by the keys they refer to: i precedes j iff keys[i] precedes
+keys[j] according to less.
+*/
+template <class Keys, class Compare>
+struct IndirectLess
+{
+    Keys keys;
+    Compare less;
+    template <class I>
+    bool operator()(I i, I j) const { return less(keys[i], keys[j]); }
+};
+
+template <class Keys, class Compare>
+IndirectLess<Keys, Compare> indirectLess(Keys keys, Compare less)
+{
+    return { keys, less };
+}
+
+/**
+Selection over an index array: permutes idx[0 .. length] (typically uint32_t
+or uint64_t, e.g. initialized with std::iota) such that keys[idx[n]] is the
+element that would be there if the indices were sorted by the keys they refer
+to, with no greater keys before and no smaller keys after it. The keys, which
+may be large records with proj extracting the field to compare, are never
+moved; all swaps are of indices. Any subset or permutation of the indices of
+keys works, as long as each occurs at most once.
+*/
+template <class P = HoarePartitioner, class Index, class Keys,
+    class Compare = std::less<>, class Projection = Identity>
+void argselect(Index* idx, size_t n, size_t length, Keys keys,
+    Compare less = Compare(), Projection proj = Projection())
+{
+    assert(n < length);
+    adaptiveQuickselect<P>(idx, n, length,
+        indirectLess(keys, projectedLess(less, proj)));
+}
+
+/**
+Key with the index of the record it comes from, for selecting over records
+without moving them and without the indirect load of each comparison in
+argselect.
+*/
+template <class K, class I>
+struct KeyIndex
+{
+    K key;
+    I index;
+};
+
+/**
+Fills out[0 .. length] with the keys proj(records[i]) and their indices i.
+*/
+template <class K, class I, class It, class Projection = Identity>
+void makeKeyIndex(It records, size_t length, KeyIndex<K, I>* out,
+    Projection proj = Projection())
+{
+    for (size_t i = 0; i < length; ++i)
+        out[i] = { K(proj(records[i])), I(i) };
+}
+
+/**
+Selection over key-index pairs, e.g. filled by makeKeyIndex: like
+adaptiveQuickselect on r[0 .. length] ordered by key only. Afterwards
+r[n].index is the index of the record of rank n.
+*/
+template <class P = HoarePartitioner, class K, class I,
+    class Compare = std::less<>>
+void keyIndexSelect(KeyIndex<K, I>* r, size_t n, size_t length,
+    Compare less = Compare())
+{
+    assert(n < length);
+    adaptiveQuickselect<P>(r, n, length,
+        [less](const KeyIndex<K, I>& a, const KeyIndex<K, I>& b)
+        {
+            return less(a.key, b.key);
+        });
+}
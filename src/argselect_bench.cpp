@@ -0,0 +1,113 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+// Times selecting the median record by key from records of 8, 64, and 256
+// bytes whose keys are read from a dataset file, in four ways: moving the
+// records themselves, argselect over uint32_t and uint64_t indices, and
+// keyIndexSelect over key-index pairs. Index and pair setup is timed too.
+
+#include <array>
+#include <cstdio>
+#include <numeric>
+#include <vector>
+#include "argselect.h"
+#include "bench.h"
+using namespace std;
+
+template <size_t size>
+struct Record
+{
+    double key;
+    array<char, size - sizeof(double)> payload;
+};
+
+// A zero-length array would still take up space
+template <>
+struct Record<sizeof(double)>
+{
+    double key;
+};
+
+struct Key
+{
+    template <class R>
+    double operator()(const R& r) const { return r.key; }
+};
+
+// Same as measure, but f returns the key it selected, which must be the same
+// as expected.
+template <class Prepare, class F>
+double measureKey(Prepare prepare, F f, double expected, bool& ok)
+{
+    double key = 0;
+    return measure(prepare, [&] { key = f(); },
+        [&] { ok = ok && key == expected; });
+}
+
+template <size_t size>
+void run(const vector<double>& keys, double expected, bool& ok)
+{
+    static_assert(sizeof(Record<size>) == size,
+        "Record<size> must take size bytes");
+    const size_t length = keys.size(), n = length / 2;
+    vector<Record<size>> records(length), work;
+    for (size_t i = 0; i < length; ++i)
+        records[i].key = keys[i];
+
+    const auto nothing = [] {};
+    const auto copy = [&] { work = records; };
+    printf("records_%zu: %g\n", size, measureKey(copy, [&]
+        {
+            adaptiveNthElement(work.begin(), work.begin() + n, work.end(),
+                less<>(), Key());
+            return work[n].key;
+        }, expected, ok));
+
+    vector<uint32_t> idx32(length);
+    printf("index32_%zu: %g\n", size, measureKey(nothing, [&]
+        {
+            iota(idx32.begin(), idx32.end(), 0);
+            argselect(idx32.data(), n, length, records.data(), less<>(),
+                Key());
+            return records[idx32[n]].key;
+        }, expected, ok));
+
+    vector<uint64_t> idx64(length);
+    printf("index64_%zu: %g\n", size, measureKey(nothing, [&]
+        {
+            iota(idx64.begin(), idx64.end(), 0);
+            argselect(idx64.data(), n, length, records.data(), less<>(),
+                Key());
+            return records[idx64[n]].key;
+        }, expected, ok));
+
+    vector<KeyIndex<double, uint32_t>> pairs(length);
+    printf("key_index_%zu: %g\n", size, measureKey(nothing, [&]
+        {
+            makeKeyIndex(records.data(), length, pairs.data(), Key());
+            keyIndexSelect(pairs.data(), n, length);
+            return records[pairs[n].index].key;
+        }, expected, ok));
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2) return 1;
+
+    vector<double> keys;
+    if (const auto rc = loadDataset(argv[1], keys)) return rc;
+
+    auto sorted = keys;
+    nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2,
+        sorted.end());
+    const auto expected = sorted[sorted.size() / 2];
+
+    bool ok = true;
+    run<8>(keys, expected, ok);
+    run<64>(keys, expected, ok);
+    run<256>(keys, expected, ok);
+    return ok ? 0 : 8;
+}
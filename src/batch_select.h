@@ -0,0 +1,227 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include "median_of_ninthers.h"
+#include "sorting_network.h"
+#include <memory>
+#include <vector>
+
+/**
+Number of arrays batchSelect runs through a network at once.
+*/
+const size_t batchLanes = 16;
+
+/**
+Whether batches of T compared with Compare can run on the vector kernels:
+T must be float, double, or an integral type of up to 8 bytes other than bool
+(GCC's vector extensions take no others), compared by operator<.
+*/
+template <class T, class Compare>
+struct UsesLaneKernel : std::false_type {};
+template <class T>
+struct UsesLaneKernel<T, std::less<>> : std::integral_constant<bool,
+    std::is_same<T, float>::value || std::is_same<T, double>::value
+    || (std::is_integral<T>::value && !std::is_same<T, bool>::value
+        && sizeof(T) <= 8)> {};
+template <class T>
+struct UsesLaneKernel<T, std::less<T>> : UsesLaneKernel<T, std::less<>> {};
+
+namespace portable
+{
+const size_t vectorBytes = 16;
+#include "batch_select_kernel.h"
+} // namespace portable
+
+#ifdef SIMD_PARTITION_X86
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+namespace avx2
+{
+const size_t vectorBytes = 32;
+#include "batch_select_kernel.h"
+} // namespace avx2
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+namespace avx512
+{
+const size_t vectorBytes = 64;
+#include "batch_select_kernel.h"
+} // namespace avx512
+#pragma GCC pop_options
+
+#endif // SIMD_PARTITION_X86
+
+/**
+Applies network to batchLanes arrays stored as for the kernels, one lane at a
+time, for types and comparators without kernels.
+*/
+template <class T, class Compare>
+void applyNetworkLanes(T (*x)[batchLanes], const Network& network,
+    Compare less, std::false_type)
+{
+    for (size_t i = 0; i < network.size; ++i)
+    {
+        const auto s = network.steps[i];
+        for (size_t l = 0; l < batchLanes; ++l)
+            if (CNT less(x[s.hi][l], x[s.lo][l]))
+                cswap(x[s.lo][l], x[s.hi][l]);
+    }
+}
+
+/**
+Same, using the kernel for the best instruction set of the host. Each step is
+accounted for as one comparison per lane.
+*/
+template <class T, class Compare>
+void applyNetworkLanes(T (*x)[batchLanes], const Network& network, Compare,
+    std::true_type)
+{
+#ifdef COUNT_COMPARISONS
+    g_comparisons += network.size * batchLanes;
+#endif
+    switch (simdLevel())
+    {
+#ifdef SIMD_PARTITION_X86
+    case SimdLevel::avx512: return avx512::applyNetworkLanes(x, network);
+    case SimdLevel::avx2: return avx2::applyNetworkLanes(x, network);
+#endif
+    default: return portable::applyNetworkLanes(x, network);
+    }
+}
+
+template <class T, class Compare>
+void applyNetworkLanes(T (*x)[batchLanes], const Network& network,
+    Compare less)
+{
+    applyNetworkLanes(x, network, less, UsesLaneKernel<T, Compare>());
+}
+
+/**
+Scratch block for batchLanes arrays of up to maxNetworkLength elements,
+stored lane by lane as the kernels expect. It is on the heap, because keys
+without kernels may be large.
+*/
+template <class T>
+using LaneBlock = std::unique_ptr<T[][batchLanes]>;
+
+template <class T>
+LaneBlock<T> makeLaneBlock()
+{
+    return LaneBlock<T>(new T[maxNetworkLength][batchLanes]);
+}
+
+/**
+Selection in an array too long for the networks: copies it and runs
+adaptiveQuickselect on the copy.
+*/
+template <class T, class Compare>
+T selectCopy(const T* r, size_t n, size_t length, std::vector<T>& buf,
+    Compare less)
+{
+    buf.assign(r, r + length);
+    adaptiveQuickselect(buf.data(), n, length, less);
+    return buf[n];
+}
+
+/**
+Selection in many small arrays: data holds count arrays of length elements
+each, one after another, and out[i] receives the element of rank n of
+data[i * length .. (i + 1) * length], as if sorted by less. data is not
+modified.
+
+Arrays of up to maxNetworkLength elements go batchLanes at a time into a
+scratch block, transposed so that element j of each array lies in row j.
+The selection network for length and n then runs on all of them at once,
+each comparator a few vector instructions for arithmetic keys compared with
+operator<, with no branches and no per-array dispatch. Longer arrays are
+copied and selected one at a time.
+*/
+template <class T, class Compare = std::less<>>
+void batchSelect(const T* data, size_t count, size_t length, size_t n,
+    T* out, Compare less = Compare())
+{
+    assert(n < length);
+    if (length > maxNetworkLength)
+    {
+        std::vector<T> buf;
+        for (size_t i = 0; i < count; ++i)
+            out[i] = selectCopy(data + i * length, n, length, buf, less);
+        return;
+    }
+    const auto network = makeSelectionNetwork(length, n);
+    const auto block = makeLaneBlock<T>();
+    const auto x = block.get();
+    for (size_t i = 0; i < count; i += batchLanes)
+    {
+        // Lanes past the last array repeat it
+        for (size_t l = 0; l < batchLanes; ++l)
+        {
+            const T* a = data + std::min(i + l, count - 1) * length;
+            for (size_t j = 0; j < length; ++j)
+                x[j][l] = a[j];
+        }
+        applyNetworkLanes(x, network, less);
+        const size_t lanes = std::min(batchLanes, count - i);
+        std::copy(x[n], x[n] + lanes, out + i);
+    }
+}
+
+/**
+Same as above, for arrays of different lengths: array i is
+data[offsets[i] .. offsets[i + 1]], and out[i] receives its element of rank
+ns[i]. Each batch is sorted with the network for its longest array, the
+shorter ones padded with copies of their maximum.
+*/
+template <class T, class Compare = std::less<>>
+void batchSelect(const T* data, const size_t* offsets, size_t count,
+    const size_t* ns, T* out, Compare less = Compare())
+{
+    std::vector<T> buf;
+    size_t batch[batchLanes];
+    const auto block = makeLaneBlock<T>();
+    const auto x = block.get();
+    for (size_t i = 0; i < count; )
+    {
+        // Gather the next batchLanes short arrays, selecting in long ones on
+        // the way
+        size_t lanes = 0, longest = 0;
+        for (; i < count && lanes < batchLanes; ++i)
+        {
+            const size_t length = offsets[i + 1] - offsets[i];
+            assert(ns[i] < length);
+            if (length > maxNetworkLength)
+            {
+                out[i] = selectCopy(data + offsets[i], ns[i], length, buf,
+                    less);
+                continue;
+            }
+            batch[lanes++] = i;
+            longest = std::max(longest, length);
+        }
+        if (lanes == 0) break;
+        for (size_t l = 0; l < batchLanes; ++l)
+        {
+            const size_t k = batch[std::min(l, lanes - 1)];
+            const T* a = data + offsets[k];
+            const size_t length = offsets[k + 1] - offsets[k];
+            size_t top = 0;
+            for (size_t j = 0; j < length; ++j)
+            {
+                x[j][l] = a[j];
+                top = CNT less(a[top], a[j]) ? j : top;
+            }
+            for (size_t j = length; j < longest; ++j)
+                x[j][l] = a[top];
+        }
+        applyNetworkLanes(x, sortingNetworks[longest], less);
+        for (size_t l = 0; l < lanes; ++l)
+            out[batch[l]] = x[ns[batch[l]]][l];
+    }
+}
@@ -0,0 +1,108 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+// Times taking the median of each of the consecutive windows of 8, 16, 32,
+// and 64 elements of a dataset file, and of windows of random lengths from 8
+// to 64, in three ways: std::nth_element and adaptiveQuickselect on a copy of
+// each window, and batchSelect on all of them. Prints arrays per second.
+
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "batch_select.h"
+#include "bench.h"
+using namespace std;
+
+// Times the three methods on the windows data[offsets[i] .. offsets[i + 1]]
+void run(const char* name, const vector<double>& data,
+    const vector<size_t>& offsets, bool& ok)
+{
+    const size_t count = offsets.size() - 1;
+    vector<size_t> ns(count);
+    for (size_t i = 0; i < count; ++i)
+        ns[i] = (offsets[i + 1] - offsets[i] - 1) / 2;
+    vector<double> out(count), buf;
+
+    vector<double> expected(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        buf.assign(data.begin() + offsets[i], data.begin() + offsets[i + 1]);
+        nth_element(buf.begin(), buf.begin() + ns[i], buf.end());
+        expected[i] = buf[ns[i]];
+    }
+
+    // Arrays per second; each run must write the expected medians to out
+    const auto clear = [&] { fill(out.begin(), out.end(), 0.0); };
+    const auto check = [&] { ok = ok && out == expected; };
+    const auto rate = [&](double ms) { return count / ms * 1000; };
+    printf("nth_element_%s: %g\n", name, rate(measure(clear, [&]
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                buf.assign(data.begin() + offsets[i],
+                    data.begin() + offsets[i + 1]);
+                nth_element(buf.begin(), buf.begin() + ns[i], buf.end());
+                out[i] = buf[ns[i]];
+            }
+        }, check)));
+
+    printf("quickselect_%s: %g\n", name, rate(measure(clear, [&]
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                buf.assign(data.begin() + offsets[i],
+                    data.begin() + offsets[i + 1]);
+                adaptiveQuickselect(buf.data(), ns[i], buf.size());
+                out[i] = buf[ns[i]];
+            }
+        }, check)));
+
+    const size_t length = offsets[1] - offsets[0];
+    bool same = true;
+    for (size_t i = 0; i <= count; ++i)
+        same = same && offsets[i] == i * length;
+    printf("batch_%s: %g\n", name, rate(measure(clear, [&]
+        {
+            if (same)
+                batchSelect(data.data(), count, length, ns[0], out.data());
+            else
+                batchSelect(data.data(), offsets.data(), count, ns.data(),
+                    out.data());
+        }, check)));
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2) return 1;
+
+    vector<double> data;
+    if (const auto rc = loadDataset(argv[1], data)) return rc;
+
+    bool ok = true;
+    for (size_t length : { 8, 16, 32, 64 })
+    {
+        if (data.size() < length) break;
+        vector<size_t> offsets;
+        for (size_t i = 0; i + length <= data.size(); i += length)
+            offsets.push_back(i);
+        offsets.push_back(offsets.back() + length);
+        run(to_string(length).c_str(), data, offsets, ok);
+    }
+
+    // Windows of random lengths, the same on every run
+    mt19937 rng(42);
+    uniform_int_distribution<size_t> lengths(8, 64);
+    vector<size_t> offsets(1, 0);
+    for (;;)
+    {
+        const auto end = offsets.back() + lengths(rng);
+        if (end > data.size()) break;
+        offsets.push_back(end);
+    }
+    if (offsets.size() > 1) run("mixed", data, offsets, ok);
+    return ok ? 0 : 8;
+}
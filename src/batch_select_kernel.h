@@ -0,0 +1,38 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+// No include guard: batch_select.h includes this once per instruction set,
+// inside that instruction set's namespace and #pragma GCC target region. It
+// expects batchLanes, Network, and the vector width vectorBytes to be in scope.
+
+/**
+Applies network to batchLanes arrays at once, stored lane by lane: element i
+of array l is x[i][l]. Each step compares whole rows, a vector at a time, and
+blends the minimum and maximum, so no step branches.
+*/
+template <class T>
+void applyNetworkLanes(T (*x)[batchLanes], const Network& network)
+{
+    constexpr size_t bytes = std::min(vectorBytes, batchLanes * sizeof(T));
+    typedef T Vector __attribute__((vector_size(bytes)));
+    const size_t lanes = bytes / sizeof(T);
+    for (size_t i = 0; i < network.size; ++i)
+    {
+        const auto s = network.steps[i];
+        T* lo = x[s.lo];
+        T* hi = x[s.hi];
+        for (size_t l = 0; l < batchLanes; l += lanes)
+        {
+            Vector a, b;
+            memcpy(&a, lo + l, bytes);
+            memcpy(&b, hi + l, bytes);
+            const auto swap = b < a;
+            const Vector min = swap ? b : a, max = swap ? a : b;
+            if (s.outputs & 1) memcpy(lo + l, &min, bytes);
+            if (s.outputs & 2) memcpy(hi + l, &max, bytes);
+        }
+    }
+}
@@ -0,0 +1,60 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <vector>
+#include <sys/stat.h>
+#include "timer.h"
+
+/**
+Reads the doubles stored in file fname into data. Returns 0, or the exit code
+the benchmark tools use for the failure: 2 if fname can't be found, 3 if its
+size is not a positive multiple of 8, and 4, 5, or 6 if it can't be opened,
+read, or closed.
+*/
+inline int loadDataset(const char* fname, std::vector<double>& data)
+{
+    struct stat stat_buf;
+    if (stat(fname, &stat_buf) != 0) return 2;
+    if (stat_buf.st_size == 0 || stat_buf.st_size % 8 != 0) return 3;
+    data.resize(stat_buf.st_size / 8);
+    const auto f = fopen(fname, "rb");
+    if (!f) return 4;
+    if (fread(data.data(), sizeof(double), data.size(), f) != data.size())
+    {
+        fclose(f);
+        return 5;
+    }
+    if (fclose(f) != 0) return 6;
+    return 0;
+}
+
+/**
+Times run over epochs calls, each preceded by an untimed call to prepare and
+followed by an untimed call to check, and returns the average duration in
+milliseconds of all calls but the outlierEpochs slowest ones.
+*/
+template <class Prepare, class Run, class Check>
+double measure(Prepare prepare, Run run, Check check, size_t epochs = 12,
+    size_t outlierEpochs = 2)
+{
+    std::vector<double> durations(epochs);
+    for (auto& d : durations)
+    {
+        prepare();
+        Timer t;
+        run();
+        d = t.elapsed();
+        check();
+    }
+    std::sort(durations.begin(), durations.end());
+    const size_t experiments = epochs - outlierEpochs;
+    return std::accumulate(durations.begin(),
+        durations.begin() + experiments, 0.0) / experiments;
+}
@@ -0,0 +1,344 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+// Times the median selection of every registered algorithm on every dataset
+// given, for each key type requested, in one process:
+//
+//     bench_runner [--warmup=N] [--reps=N] [--format=csv|json]
+//         [--algos=name,...] [--types=name,...] dataset...
+//
+// Each dataset is a file of doubles, or kind:length for data generated in
+// memory (see generatorKinds). The kind antiqsort stands for the input that
+// McIlroy's adversary builds for each algorithm in turn (see antiqsort);
+// radix_select, which doesn't compare keys, is skipped on it.
+//
+// Key types are int32, int64, float, double (the default), string, and
+// record. Keys other than double are made from the rank of each double in
+// its dataset (see KeyType), so every type sees the same order as the dataset.
+//
+// Each run first restores the input from a copy, outside the timing, into a
+// buffer allocated once per type for the largest dataset (with memcpy where
+// the type allows). Like main.cpp, datasets whose names contain "random" are
+// reshuffled between runs. Warmup runs are not recorded; the rest yield the
+// median, 10th and 90th percentile, and median absolute deviation of the
+// durations in milliseconds, printed as one CSV line or JSON object per
+// dataset, type, and algorithm.
+
+#include "algorithms.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <sys/stat.h>
+#include "key_types.h"
+#include "timer.h"
+
+using namespace std;
+
+// Summary of the durations of the recorded runs, in milliseconds
+struct Timings
+{
+    double median, p10, p90, mad;
+};
+
+// Element of sorted[0 .. length] at fraction q of the way, interpolated
+double percentile(const double* sorted, size_t length, double q)
+{
+    const double x = q * (length - 1);
+    const size_t i = size_t(x);
+    if (i + 1 >= length) return sorted[length - 1];
+    return sorted[i] + (x - i) * (sorted[i + 1] - sorted[i]);
+}
+
+Timings summarize(vector<double> durations)
+{
+    sort(durations.begin(), durations.end());
+    Timings result;
+    const size_t n = durations.size();
+    result.median = percentile(durations.data(), n, 0.5);
+    result.p10 = percentile(durations.data(), n, 0.1);
+    result.p90 = percentile(durations.data(), n, 0.9);
+    for (auto& d : durations) d = fabs(d - result.median);
+    sort(durations.begin(), durations.end());
+    result.mad = percentile(durations.data(), n, 0.5);
+    return result;
+}
+
+// Splits a generated dataset kind:length, returning false if spec isn't one
+bool parseGenerated(const char* spec, string& kind, size_t& length)
+{
+    const auto colon = strchr(spec, ':');
+    if (!colon) return false;
+    kind.assign(spec, colon);
+    char* end;
+    length = strtoull(colon + 1, &end, 10);
+    if (*end || length == 0) return false;
+    if (kind == "antiqsort") return true;
+    for (auto k = generatorKinds; *k; ++k)
+        if (kind == *k) return true;
+    return false;
+}
+
+// Number of doubles in a dataset, or 0 if it can't be one
+size_t datasetLength(const char* spec)
+{
+    string kind;
+    size_t length;
+    if (parseGenerated(spec, kind, length))
+        return generatedLength(kind.c_str(), length);
+    struct stat stat_buf;
+    if (stat(spec, &stat_buf) != 0) return 0;
+    if (stat_buf.st_size % 8 != 0) return 0;
+    return stat_buf.st_size / 8;
+}
+
+// Dataset name: the file name without directory and extension, or
+// kind_length for generated data
+string datasetName(const char* spec)
+{
+    string result = spec;
+    const auto colon = result.find(':');
+    if (colon != string::npos) return result.replace(colon, 1, "_");
+    const auto slash = result.rfind('/');
+    if (slash != string::npos) result.erase(0, slash + 1);
+    const auto dot = result.rfind('.');
+    if (dot != string::npos) result.erase(dot);
+    return result;
+}
+
+// Reads or generates the length doubles of a dataset into raw. For antiqsort,
+// algorithm names the algorithm to build it for. Returns 0 or an exit code.
+int loadDataset(const char* spec, size_t length, const char* algorithm,
+    double* raw)
+{
+    string kind;
+    size_t generated;
+    if (parseGenerated(spec, kind, generated))
+    {
+        if (kind == "antiqsort")
+            return antiqsortFor(algorithm, raw, length) ? 0 : 7;
+        return generate(kind.c_str(), raw, length) ? 0 : 7;
+    }
+    const auto f = fopen(spec, "rb");
+    if (!f) return 4;
+    if (fread(raw, sizeof(double), length, f) != length) return 5;
+    if (fclose(f) != 0) return 6;
+    return 0;
+}
+
+// Copies src[0 .. length] over dst, with memcpy where T allows it
+template <class T>
+void restore(T* dst, const T* src, size_t length, true_type)
+{
+    memcpy(dst, src, length * sizeof(T));
+}
+
+template <class T>
+void restore(T* dst, const T* src, size_t length, false_type)
+{
+    copy(src, src + length, dst);
+}
+
+struct Options
+{
+    size_t warmup = 2, reps = 20;
+    bool json = false;
+    vector<string> algos;
+    vector<const char*> files;
+    size_t capacity = 0;
+};
+
+// Prints a row of results; the first of all rows has first set
+void printRow(const Options& opts, bool first, const string& dataset,
+    size_t size, const char* type, const char* algorithm, const Timings& t)
+{
+    if (opts.json)
+    {
+        printf("%s  {\"dataset\": \"%s\", \"size\": %zu, \"type\": \"%s\", "
+            "\"algorithm\": \"%s\", \"reps\": %zu, \"median_ms\": %g, "
+            "\"p10_ms\": %g, \"p90_ms\": %g, \"mad_ms\": %g}",
+            first ? "" : ",\n", dataset.c_str(), size, type, algorithm,
+            opts.reps, t.median, t.p10, t.p90, t.mad);
+    }
+    else
+    {
+        printf("%s,%zu,%s,%s,%zu,%g,%g,%g,%g\n", dataset.c_str(), size, type,
+            algorithm, opts.reps, t.median, t.p10, t.p90, t.mad);
+    }
+    fflush(stdout);
+}
+
+// Runs the selected algorithms over all files with keys of type T. Returns
+// 0 or an exit code.
+template <class T>
+int run(const Options& opts, vector<double>& raw, bool& first)
+{
+    vector<Algorithm<T>> selected;
+    for (const auto& a : algorithms<T>())
+    {
+        if (opts.algos.empty()
+            || find(opts.algos.begin(), opts.algos.end(), a.name)
+                != opts.algos.end())
+            selected.push_back(a);
+    }
+    if (selected.empty()) return 0;
+
+    vector<T> data(opts.capacity), work(opts.capacity);
+    vector<double> durations(opts.reps), distinct;
+    std::mt19937 g(1);
+    for (auto path : opts.files)
+    {
+        const size_t length = datasetLength(path);
+        const bool randomInput = strstr(path, "random") != nullptr;
+        // Adversarial inputs differ by algorithm
+        const bool adversarial = strncmp(path, "antiqsort:", 10) == 0;
+        const size_t index = length / 2;
+        const auto name = datasetName(path);
+        T median{};
+        // Loads keys from the dataset, converts them to T, and finds their
+        // median
+        const auto load = [&](const char* algorithm)
+        {
+            const auto rc = loadDataset(path, length, algorithm, raw.data());
+            if (rc != 0) return rc;
+            makeKeys(raw.data(), length, data.data(), distinct);
+            copy(data.begin(), data.begin() + length, work.begin());
+            nth_element(work.begin(), work.begin() + index,
+                work.begin() + length);
+            median = work[index];
+            return 0;
+        };
+        if (!adversarial)
+            if (const auto rc = load(nullptr)) return rc;
+
+        for (const auto& a : selected)
+        {
+            if (adversarial)
+            {
+                // Not for algorithms that don't compare keys
+                if (!findAlgorithm<AdversaryKey>(a.name).select) continue;
+                if (const auto rc = load(a.name)) return rc;
+            }
+            for (size_t i = 0; i < opts.warmup + opts.reps; ++i)
+            {
+                if (randomInput && i > 0)
+                    shuffle(data.begin(), data.begin() + length, g);
+                restore(work.data(), data.data(), length,
+                    is_trivially_copyable<T>());
+                const auto b = work.data();
+                //////////////////// TIMING {
+                Timer t;
+                a.select(b, b + index, b + length);
+                const double elapsed = t.elapsed();
+                //////////////////// } TIMING
+                if (work[index] < median || median < work[index])
+                {
+                    fprintf(stderr, "%s: wrong median of %s on %s\n",
+                        a.name, KeyType<T>::name(), path);
+                    return 8;
+                }
+                if (i >= opts.warmup) durations[i - opts.warmup] = elapsed;
+            }
+            printRow(opts, first, name, length, KeyType<T>::name(), a.name,
+                summarize(durations));
+            first = false;
+        }
+    }
+    return 0;
+}
+
+// Splits a comma-separated list
+vector<string> split(const char* s)
+{
+    vector<string> result;
+    for (;;)
+    {
+        const auto end = strchrnul(s, ',');
+        result.emplace_back(s, end);
+        if (!*end) return result;
+        s = end + 1;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options opts;
+    vector<string> types;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--warmup=", 9) == 0)
+        {
+            opts.warmup = strtoull(arg + 9, nullptr, 10);
+        }
+        else if (strncmp(arg, "--reps=", 7) == 0)
+        {
+            opts.reps = strtoull(arg + 7, nullptr, 10);
+        }
+        else if (strcmp(arg, "--format=csv") == 0)
+        {
+            opts.json = false;
+        }
+        else if (strcmp(arg, "--format=json") == 0)
+        {
+            opts.json = true;
+        }
+        else if (strncmp(arg, "--algos=", 8) == 0)
+        {
+            opts.algos = split(arg + 8);
+        }
+        else if (strncmp(arg, "--types=", 8) == 0)
+        {
+            types = split(arg + 8);
+        }
+        else if (strncmp(arg, "--", 2) == 0)
+        {
+            return 1;
+        }
+        else
+        {
+            opts.files.push_back(arg);
+        }
+    }
+    if (opts.files.empty() || opts.reps == 0) return 1;
+    if (types.empty()) types.push_back("double");
+    // Algorithm names are checked against those for double, the most
+    // complete list
+    for (const auto& name : opts.algos)
+        if (!findAlgorithm<double>(name).select) return 1;
+
+    // Allocate the buffer of doubles once, for the largest dataset
+    for (auto path : opts.files)
+    {
+        const auto length = datasetLength(path);
+        if (length == 0) return 3;
+        opts.capacity = max(opts.capacity, length);
+    }
+    vector<double> raw(opts.capacity);
+
+    if (opts.json) printf("[\n");
+    else printf("dataset,size,type,algorithm,reps,median_ms,p10_ms,p90_ms,"
+        "mad_ms\n");
+    bool first = true;
+    for (const auto& type : types)
+    {
+        int rc;
+        if (type == "int32") rc = run<int32_t>(opts, raw, first);
+        else if (type == "int64") rc = run<int64_t>(opts, raw, first);
+        else if (type == "float") rc = run<float>(opts, raw, first);
+        else if (type == "double") rc = run<double>(opts, raw, first);
+        else if (type == "string") rc = run<string>(opts, raw, first);
+        else if (type == "record") rc = run<FatRecord>(opts, raw, first);
+        else return 1;
+        if (rc != 0) return rc;
+    }
+    if (opts.json) printf("\n]\n");
+}
@@ -18,7 +18,7 @@ static T* partition(T* r, T* end)
         partition5(r, i - 4, i - 3, i, i - 2, i - 1);
         cswap(r[i], r[j]);
     }
-    quickselect<double, &partition>(r, r + j / 2, r + j);
+    quickselect<T, &partition>(r, r + j / 2, r + j);
     return pivotPartition(r, j / 2, len);
 }
 
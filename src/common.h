@@ -7,18 +7,26 @@
 #pragma once
 #include <algorithm>
 #include <cassert>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include "sorting_network.h"
 
 /**
-Instrumentation counters
+Instrumentation counters, one set per thread so that concurrent selections
+neither race on them nor mix their counts. Work done on other threads on
+behalf of a call (see ThreadPool) is counted by those threads. They are
+defined in counters.cpp, which every binary links.
 */
 #ifdef COUNT_SWAPS
-extern unsigned long g_swaps;
+extern thread_local unsigned long g_swaps;
 #endif
 #ifdef COUNT_WASTED_SWAPS
-extern unsigned long g_wastedSwaps;
+extern thread_local unsigned long g_wastedSwaps;
 #endif
 #ifdef COUNT_COMPARISONS
-extern unsigned long g_comparisons;
+extern thread_local unsigned long g_comparisons;
 #endif
 
 /**
@@ -46,187 +54,134 @@ Instrumented comparisons
 #endif
 
 /**
-Swaps the median of r[a], r[b], and r[c] into r[b].
+All routines below work on random-access iterators and order elements by a
+comparator less (defaulting to operator<), with the same requirements as the
+comparator of std::nth_element. ProjectedLess adapts a comparator to compare
+projections of elements, e.g. a member of a struct.
 */
-template <class T>
-void median3(T* r, size_t a, size_t b, size_t c)
+struct Identity
 {
-    if (r[b] <CNT r[a]) // b < a
-    {
-        if (r[b] <CNT r[c]) // b < a, b < c
-        {
-            if (r[c] <CNT r[a]) // b < c < a
-                cswap(r[b], r[c]);
-            else  // b < a <= c
-                cswap(r[b], r[a]);
-        }
-    }
-    else if (r[c] <CNT r[b]) // a <= b, c < b
-    {
-        if (r[c] <CNT r[a]) // c < a <= b
-            cswap(r[b], r[a]);
-        else  // a <= c < b
-            cswap(r[b], r[c]);
-    }
-    assert(r[a] <= r[b] && r[b] <= r[c] || r[a] >= r[b] && r[b] >= r[c]);
-}
+    template <class T>
+    T&& operator()(T&& x) const { return std::forward<T>(x); }
+};
 
-/**
-Sorts in place r[a], r[b], and r[c].
-*/
-template <class T>
-void sort3(T* r, size_t a, size_t b, size_t c)
+template <class Compare, class Projection>
+struct ProjectedLess
 {
-    if (r[b] <CNT r[a]) // b < a
+    Compare less;
+    Projection proj;
+    template <class T, class U>
+    bool operator()(T&& a, U&& b) const
     {
-        if (r[c] <CNT r[b]) // c < b < a
-        {
-            cswap(r[a], r[c]); // a < b < c
-        }
-        else // b < a, b <= c
-        {
-            auto t = r[a];
-            r[a] = r[b];
-            if (r[c] <CNT t) // b <= c < a
-            {
-                r[b] = r[c];
-                r[c] = t;
-            }
-            else // b < a <= c
-            {
-                r[b] = t;
-            }
-        }
-    }
-    else if (r[c] <CNT r[b]) // a <= b, c < b
-    {
-        auto t = r[c];
-        r[c] = r[b];
-        if (t <CNT r[a]) // c < a < b
-        {
-            r[b] = r[a];
-            r[a] = t;
-        }
-        else // a <= c < b
-        {
-            r[b] = t;
-        }
+        return less(proj(std::forward<T>(a)), proj(std::forward<U>(b)));
     }
+};
 
-    assert(r[a] <= r[b] && r[b] <= r[c]);
+template <class Compare, class Projection>
+ProjectedLess<Compare, Projection> projectedLess(Compare less, Projection proj)
+{
+    return { less, proj };
+}
+
+template <class Compare>
+Compare projectedLess(Compare less, Identity)
+{
+    return less;
 }
 
 /**
-If leanRight == false, swaps the lower median of r[a]...r[d] into r[b] and
-the minimum into r[a]. If leanRight == true, swaps the upper median of
-r[a]...r[d] into r[c] and the minimum into r[d].
+Swaps the median of r[a], r[b], and r[c] into r[b].
 */
-template <bool leanRight, class T>
-void partition4(T* r, size_t a, size_t b, size_t c, size_t d)
+template <class It, class Compare = std::less<>>
+void median3(It r, size_t a, size_t b, size_t c, Compare less = Compare())
 {
-    assert(a != b && a != c && a != d && b != c && b != d
-        && c != d);
-    /* static */ if (leanRight)
+    if (CNT less(r[b], r[a])) // b < a
     {
-        // In the median of 5 algorithm, consider r[e] infinite
-        if (r[c] <CNT r[a]) {
-            cswap(r[a], r[c]);
-        } // a <= c
-        if (r[d] <CNT r[b]) {
-            cswap(r[b], r[d]);
-        } // a <= c, b <= d
-        if (r[d] <CNT r[c]) {
-            cswap(r[c], r[d]); // a <= d, b <= c < d
-            cswap(r[a], r[b]); // b <= d, a <= c < d
-        } // a <= c <= d, b <= d
-        if (r[c] <CNT r[b]) { // a <= c <= d, c < b <= d
-            cswap(r[b], r[c]); // a <= b <= c <= d
-        } // a <= b <= c <= d
-        assert(r[a] <= r[c] && r[b] <= r[c] && r[c] <= r[d]);
+        if (CNT less(r[b], r[c])) // b < a, b < c
+        {
+            if (CNT less(r[c], r[a])) // b < c < a
+                cswap(r[b], r[c]);
+            else  // b < a <= c
+                cswap(r[b], r[a]);
+        }
     }
-    else
+    else if (CNT less(r[c], r[b])) // a <= b, c < b
     {
-        // In the median of 5 algorithm consider r[a] infinitely small, then
-        // change b->a. c->b, d->c, e->d
-        if (r[c] <CNT r[a]) {
-            cswap(r[a], r[c]);
-        }
-        if (r[c] <CNT r[b]) {
+        if (CNT less(r[c], r[a])) // c < a <= b
+            cswap(r[b], r[a]);
+        else  // a <= c < b
             cswap(r[b], r[c]);
-        }
-        if (r[d] <CNT r[a]) {
-            cswap(r[a], r[d]);
-        }
-        if (r[d] <CNT r[b]) {
-            cswap(r[b], r[d]);
-        } else {
-            if (r[b] <CNT r[a]) {
-                cswap(r[a], r[b]);
-            }
-        }
-        assert(r[a] <= r[b] && r[b] <= r[c] && r[b] <= r[d]);
     }
+    assert(!less(r[b], r[a]) && !less(r[c], r[b])
+        || !less(r[a], r[b]) && !less(r[b], r[c]));
 }
 
 /**
 Places the median of r[a]...r[e] in r[c] and partitions the other elements
-around it.
+around it. Used by bfprt_baseline: it takes at most 6 comparisons, where the
+partition network for 5 elements and rank 2 takes 8.
 */
-template <class T>
-void partition5(T* r, size_t a, size_t b, size_t c, size_t d, size_t e)
+template <class It, class Compare = std::less<>>
+void partition5(It r, size_t a, size_t b, size_t c, size_t d, size_t e,
+    Compare less = Compare())
 {
     assert(a != b && a != c && a != d && a != e && b != c && b != d && b != e
         && c != d && c != e && d != e);
-    if (r[c] <CNT r[a]) {
+    if (CNT less(r[c], r[a])) {
         cswap(r[a], r[c]);
     }
-    if (r[d] <CNT r[b]) {
+    if (CNT less(r[d], r[b])) {
         cswap(r[b], r[d]);
     }
-    if (r[d] <CNT r[c]) {
+    if (CNT less(r[d], r[c])) {
         cswap(r[c], r[d]);
         cswap(r[a], r[b]);
     }
-    if (r[e] <CNT r[b]) {
+    if (CNT less(r[e], r[b])) {
         cswap(r[b], r[e]);
     }
-    if (r[e] <CNT r[c]) {
+    if (CNT less(r[e], r[c])) {
         cswap(r[c], r[e]);
-        if (r[c] <CNT r[a]) {
+        if (CNT less(r[c], r[a])) {
             cswap(r[a], r[c]);
         }
     } else {
-        if (r[c] <CNT r[b]) {
+        if (CNT less(r[c], r[b])) {
             cswap(r[b], r[c]);
         }
     }
-    assert(r[a] <= r[c] && r[b] <= r[c] && r[c] <= r[d] && r[c] <= r[e]);
+    assert(!less(r[c], r[a]) && !less(r[c], r[b]) && !less(r[d], r[c])
+        && !less(r[e], r[c]));
 }
 
 /**
-Implements Hoare partition.
+Hoare partition loop around r[0] over r[lo .. hi]. Input assumptions:
+
+(a) 0 < lo, lo <= hi + 1
+(b) the range r[1 .. lo] contains elements no greater than r[0]
+(c) the range r[hi + 1 .. ] contains elements no smaller than r[0]
+
+Returns the new position of the pivot.
 */
-template <class T>
-T* pivotPartition(T* r, size_t k, size_t length)
+template <class It, class Compare = std::less<>>
+It hoarePartition(It r, size_t lo, size_t hi, Compare less = Compare())
 {
-    assert(k < length);
-    cswap(*r, r[k]);
-    size_t lo = 1, hi = length - 1;
+    assert(lo > 0 && lo <= hi + 1);
     for (;; ++lo, --hi)
     {
         for (;; ++lo)
         {
             if (lo > hi) goto loop_done;
-            if (r[lo] >=CNT *r) break;
+            if (!(CNT less(r[lo], *r))) break;
         }
         // found the left bound:  r[lo] >= r[0]
         assert(lo <= hi);
-        for (; *r <CNT r[hi]; --hi)
+        for (; CNT less(*r, r[hi]); --hi)
         {
         }
         if (lo >= hi) break;
         // found the right bound: r[hi] <= r[0], swap & make progress
-        assert(r[lo] >= r[hi]);
+        assert(!less(r[lo], r[hi]));
         cswap(r[lo], r[hi]);
     }
 loop_done:
@@ -235,39 +190,142 @@ loop_done:
     return r + lo;
 }
 
+/**
+Implements Hoare partition.
+*/
+template <class It, class Compare = std::less<>>
+It pivotPartition(It r, size_t k, size_t length, Compare less = Compare())
+{
+    assert(k < length);
+    cswap(*r, r[k]);
+    return hoarePartition(r, 1, length - 1, less);
+}
+
+/**
+Number of elements scanned at a time by blockPartition. Offsets within a block
+are kept in unsigned char, so it must not exceed 256.
+*/
+const size_t partitionBlockSize = 128;
+
+/**
+Block partition after Edelkamp and Weiß's BlockQuicksort. Scans r[left ..]
+upwards and r[.. right] downwards one block at a time, recording without
+branches the offsets of elements that are on the wrong side of pivot, and then
+swaps them pairwise. Like in Hoare partition, elements equal to pivot are
+swapped as well, which keeps the split balanced on inputs with many duplicates.
+
+The left scan stays below leftEnd and the right scan at or above rightBegin.
+Blocks that lie entirely below leftKnown (respectively at or above rightKnown)
+are known to be misplaced wholesale and are not compared at all.
+
+Stops when there's no room for another pair of disjoint blocks, leaving left
+and right at the first (respectively last) element not yet known to be in
+place. The caller finishes r[left .. right] with a scalar loop.
+*/
+template <class It, class Compare>
+void blockPartition(It r,
+    const typename std::iterator_traits<It>::value_type& pivot,
+    size_t& left, size_t leftEnd, size_t leftKnown,
+    size_t& right, size_t rightBegin, size_t rightKnown, Compare less)
+{
+    const size_t B = partitionBlockSize;
+    unsigned char offsetsL[B], offsetsR[B];
+    size_t numL = 0, numR = 0, startL = 0, startR = 0;
+    while (right + 1 - left >= 2 * B)
+    {
+        if (numL == 0)
+        {
+            if (leftEnd - left < B) break;
+            startL = 0;
+            if (left + B <= leftKnown)
+            {
+                for (size_t i = 0; i < B; ++i) offsetsL[i] = i;
+                numL = B;
+            }
+            else for (size_t i = 0; i < B; ++i)
+            {
+                offsetsL[numL] = i;
+                numL += !(CNT less(r[left + i], pivot));
+            }
+        }
+        if (numR == 0)
+        {
+            if (right + 1 - rightBegin < B) break;
+            startR = 0;
+            if (right + 1 - B >= rightKnown)
+            {
+                for (size_t i = 0; i < B; ++i) offsetsR[i] = i;
+                numR = B;
+            }
+            else for (size_t i = 0; i < B; ++i)
+            {
+                offsetsR[numR] = i;
+                numR += !(CNT less(pivot, r[right - i]));
+            }
+        }
+        const auto num = std::min(numL, numR);
+        for (size_t i = 0; i < num; ++i)
+            cswap(r[left + offsetsL[startL + i]],
+                r[right - offsetsR[startR + i]]);
+        numL -= num;
+        numR -= num;
+        startL += num;
+        startR += num;
+        if (numL == 0) left += B;
+        if (numR == 0) right -= B;
+    }
+}
+
+/**
+Step of a network: moves the smaller of x and y to x and the larger to y,
+with selects instead of a branch, so the compiler can use conditional moves.
+*/
+template <class T, class Compare>
+void compareExchange(T& x, T& y, Compare less)
+{
+    const T a = x, b = y;
+    const bool swap = CNT less(b, a);
+    const T min = swap ? b : a, max = swap ? a : b;
+    x = min;
+    y = max;
+}
+
+/**
+Places in r[n] the element that would be there if r[0 .. length] were sorted,
+with no greater elements before it and no smaller ones after, using the
+partition network for length and n generated at compile time. No step
+branches on the data.
+*/
+template <class It, class Compare = std::less<>>
+void networkSelect(It r, size_t n, size_t length, Compare less = Compare())
+{
+    assert(n < length && length <= maxPartitionNetworkLength);
+    const auto& networks = partitionNetworks;
+    const auto* s = networks.steps + networks.first[length][n];
+    const auto* const end = networks.steps + networks.first[length][n + 1];
+    for (; s != end; ++s)
+        compareExchange(r[s->lo], r[s->hi], less);
+}
+
 /**
 Implements the quickselect algorithm, parameterized with a partition function.
+Ranges of up to maxPartitionNetworkLength elements are finished with
+networkSelect.
 */
 template <class T, T* (*partition)(T*, T*)>
 void quickselect(T* r, T* mid, T* end)
 {
     if (r == end || mid >= end) return;
     assert(r <= mid && mid < end);
-    for (;;) switch (end - r)
+    for (;;)
     {
-    case 1:
-        return;
-    case 2:
-        if (*r >CNT r[1]) cswap(*r, r[1]);
-        return;
-    case 3:
-        sort3(r, 0, 1, 2);
-        return;
-    case 4:
-        switch (mid - r)
+        if (end - r <= ptrdiff_t(maxPartitionNetworkLength))
         {
-            case 0: goto select_min;
-            case 1: partition4<false>(r, 0, 1, 2, 3); break;
-            case 2: partition4<true>(r, 0, 1, 2, 3); break;
-            case 3: goto select_max;
-            default: assert(false);
+            networkSelect(r, mid - r, end - r);
+            return;
         }
-        return;
-    default:
-        assert(end - r > 4);
         if (r == mid)
         {
-        select_min:
             auto pivot = r;
             for (++mid; mid < end; ++mid)
                 if (*mid <CNT *pivot) pivot = mid;
@@ -276,7 +334,6 @@ void quickselect(T* r, T* mid, T* end)
         }
         if (mid + 1 == end)
         {
-        select_max:
             auto pivot = r;
             for (mid = r + 1; mid < end; ++mid)
                 if (*pivot <CNT *mid) pivot = mid;
@@ -300,12 +357,13 @@ void quickselect(T* r, T* mid, T* end)
 Returns the index of the median of r[a], r[b], and r[c] without writing
 anything.
 */
-template <class T>
-size_t medianIndex(const T* r, size_t a, size_t b, size_t c)
+template <class It, class Compare = std::less<>>
+size_t medianIndex(It r, size_t a, size_t b, size_t c,
+    Compare less = Compare())
 {
-    if (r[a] >CNT r[c]) std::swap(a, c);
-    if (r[b] >CNT r[c]) return c;
-    if (r[b] <CNT r[a]) return a;
+    if (CNT less(r[c], r[a])) std::swap(a, c);
+    if (CNT less(r[c], r[b])) return c;
+    if (CNT less(r[b], r[a])) return a;
     return b;
 }
 
@@ -314,32 +372,33 @@ Returns the index of the median of r[a], r[b], r[c], and r[d] without writing
 anything. If leanRight is true, computes the upper median. Otherwise, conputes
 the lower median.
 */
-template <bool leanRight, class T>
-static size_t medianIndex(T* r, size_t a, size_t b, size_t c, size_t d)
+template <bool leanRight, class It, class Compare = std::less<>>
+static size_t medianIndex(It r, size_t a, size_t b, size_t c, size_t d,
+    Compare less = Compare())
 {
-    if (r[d] <CNT r[c]) std::swap(c, d);
-    assert(r[c] <= r[d]);
+    if (CNT less(r[d], r[c])) std::swap(c, d);
+    assert(!less(r[d], r[c]));
     /* static */ if (leanRight)
     {
-        if (r[c] <CNT r[a])
+        if (CNT less(r[c], r[a]))
         {
-            assert(r[c] < r[a] && r[c] <= r[d]); // so r[c] is out
-            return medianIndex(r, a, b, d);
+            assert(less(r[c], r[a]) && !less(r[d], r[c])); // so r[c] is out
+            return medianIndex(r, a, b, d, less);
         }
-        assert(r[a] <= r[c] && r[a] <= r[d]); // so r[a] is out
+        assert(!less(r[c], r[a]) && !less(r[d], r[a])); // so r[a] is out
     }
     else
     {
-        if (r[d] >=CNT r[a])
+        if (!(CNT less(r[d], r[a])))
         {
-            assert(r[d] >= r[c] && r[d] >= r[a]); // so r[d] is out
-            return medianIndex(r, a, b, c);
+            assert(!less(r[d], r[c]) && !less(r[d], r[a])); // so r[d] is out
+            return medianIndex(r, a, b, c, less);
         }
-        assert(r[a] > r[d] && r[a] > r[c]); // so r[a] is out
+        assert(less(r[d], r[a]) && less(r[c], r[a])); // so r[a] is out
     }
     // Could return medianIndex(r, b, c, d) but we already know r[c] <= r[d]
-    if (r[b] <=CNT r[c]) return c;
-    if (r[b] >CNT r[d]) return d;
+    if (!(CNT less(r[c], r[b]))) return c;
+    if (CNT less(r[d], r[b])) return d;
     return b;
 }
 
@@ -348,21 +407,21 @@ Tukey's Ninther: compute the median of r[_1], r[_2], r[_3], then the median of
 r[_4], r[_5], r[_6], then the median of r[_7], r[_8], r[_9], and then swap the
 median of those three medians into r[_5].
 */
-template <class T>
-void ninther(T* r, size_t _1, size_t _2, size_t _3, size_t _4, size_t _5,
-    size_t _6, size_t _7, size_t _8, size_t _9)
+template <class It, class Compare = std::less<>>
+void ninther(It r, size_t _1, size_t _2, size_t _3, size_t _4, size_t _5,
+    size_t _6, size_t _7, size_t _8, size_t _9, Compare less = Compare())
 {
-    _2 = medianIndex(r, _1, _2, _3);
-    _8 = medianIndex(r, _7, _8, _9);
-    if (r[_2] >CNT r[_8]) std::swap(_2, _8);
-    if (r[_4] >CNT r[_6]) std::swap(_4, _6);
+    _2 = medianIndex(r, _1, _2, _3, less);
+    _8 = medianIndex(r, _7, _8, _9, less);
+    if (CNT less(r[_8], r[_2])) std::swap(_2, _8);
+    if (CNT less(r[_6], r[_4])) std::swap(_4, _6);
     // Here we know that r[_2] and r[_8] are the other two medians and that
     // r[_2] <= r[_8]. We also know that r[_4] <= r[_6]
-    if (r[_5] <CNT r[_4])
+    if (CNT less(r[_5], r[_4]))
     {
         // r[_4] is the median of r[_4], r[_5], r[_6]
     }
-    else if (r[_5] >CNT r[_6])
+    else if (CNT less(r[_6], r[_5]))
     {
         // r[_6] is the median of r[_4], r[_5], r[_6]
         _4 = _6;
@@ -370,14 +429,14 @@ void ninther(T* r, size_t _1, size_t _2, size_t _3, size_t _4, size_t _5,
     else
     {
         // Here we know r[_5] is the median of r[_4], r[_5], r[_6]
-        if (r[_5] <CNT r[_2]) return cswap(r[_5], r[_2]);
-        if (r[_5] >CNT r[_8]) return cswap(r[_5], r[_8]);
+        if (CNT less(r[_5], r[_2])) return cswap(r[_5], r[_2]);
+        if (CNT less(r[_8], r[_5])) return cswap(r[_5], r[_8]);
         // This is the only path that returns with no swap
         return;
     }
     // Here we know r[_4] is the median of r[_4], r[_5], r[_6]
-    if (r[_4] <CNT r[_2]) _4 = _2;
-    else if (r[_4] >CNT r[_8]) _4 = _8;
+    if (CNT less(r[_4], r[_2])) _4 = _2;
+    else if (CNT less(r[_8], r[_4])) _4 = _8;
     cswap(r[_5], r[_4]);
 }
 
@@ -390,8 +449,9 @@ Input assumptions:
 Output guarantee: same as Hoare partition using r[0] as pivot. Returns the new
 position of the pivot.
 */
-template <class T>
-size_t expandPartitionRight(T* r, size_t hi, size_t rite)
+template <class It, class Compare = std::less<>>
+size_t expandPartitionRight(It r, size_t hi, size_t rite,
+    Compare less = Compare())
 {
     size_t pivot = 0;
     assert(pivot <= hi);
@@ -400,19 +460,19 @@ size_t expandPartitionRight(T* r, size_t hi, size_t rite)
     for (; pivot < hi; --rite)
     {
         if (rite == hi) goto done;
-        if (r[rite] >=CNT r[0]) continue;
+        if (!(CNT less(r[rite], r[0]))) continue;
         ++pivot;
-        assert(r[pivot] >= r[0]);
+        assert(!less(r[pivot], r[0]));
         cswap(r[rite], r[pivot]);
     }
     // Second loop: make left and pivot meet
     for (; rite > pivot; --rite)
     {
-        if (r[rite] >=CNT r[0]) continue;
+        if (!(CNT less(r[rite], r[0]))) continue;
         while (rite > pivot)
         {
             ++pivot;
-            if (r[0] <CNT r[pivot])
+            if (CNT less(r[0], r[pivot]))
             {
                 cswap(r[rite], r[pivot]);
                 break;
@@ -435,8 +495,9 @@ Output guarantee: Same as Hoare partition around r[pivot]. Returns the new
 position of the pivot.
 
 */
-template <class T>
-size_t expandPartitionLeft(T* r, size_t lo, size_t pivot)
+template <class It, class Compare = std::less<>>
+size_t expandPartitionLeft(It r, size_t lo, size_t pivot,
+    Compare less = Compare())
 {
     assert(lo > 0 && lo <= pivot);
     size_t left = 0;
@@ -444,21 +505,21 @@ size_t expandPartitionLeft(T* r, size_t lo, size_t pivot)
     for (; lo < pivot; ++left)
     {
         if (left == lo) goto done;
-        if (r[oldPivot] >=CNT r[left]) continue;
+        if (!(CNT less(r[oldPivot], r[left]))) continue;
         --pivot;
-        assert(r[oldPivot] >= r[pivot]);
+        assert(!less(r[oldPivot], r[pivot]));
         cswap(r[left], r[pivot]);
     }
     // Second loop: make left and pivot meet
     for (;; ++left)
     {
         if (left == pivot) break;
-        if (r[oldPivot] >=CNT r[left]) continue;
+        if (!(CNT less(r[oldPivot], r[left]))) continue;
         for (;;)
         {
             if (left == pivot) goto done;
             --pivot;
-            if (r[pivot] <CNT r[oldPivot])
+            if (CNT less(r[pivot], r[oldPivot]))
             {
                 cswap(r[left], r[pivot]);
                 break;
@@ -483,8 +544,9 @@ r[pivot]
 Output guarantee: Same as Hoare partition around r[pivot], returning the new
 position of the pivot.
 */
-template <class T>
-size_t expandPartition(T* r, size_t lo, size_t pivot, size_t hi, size_t length)
+template <class It, class Compare = std::less<>>
+size_t expandPartition(It r, size_t lo, size_t pivot, size_t hi, size_t length,
+    Compare less = Compare())
 {
     assert(lo <= pivot && pivot < hi && hi <= length);
     --hi;
@@ -496,16 +558,91 @@ size_t expandPartition(T* r, size_t lo, size_t pivot, size_t hi, size_t length)
         {
             if (left == lo)
                 return pivot +
-                    expandPartitionRight(r + pivot, hi - pivot, length - pivot);
-            if (r[left] >CNT r[pivot]) break;
+                    expandPartitionRight(r + pivot, hi - pivot, length - pivot,
+                        less);
+            if (CNT less(r[pivot], r[left])) break;
         }
         for (;; --length)
         {
             if (length == hi)
                 return left +
-                    expandPartitionLeft(r + left, lo - left, pivot - left);
-            if (r[pivot] >=CNT r[length]) break;
+                    expandPartitionLeft(r + left, lo - left, pivot - left,
+                        less);
+            if (!(CNT less(r[pivot], r[length]))) break;
         }
         cswap(r[left], r[length]);
     }
 }
+
+/**
+Same as expandPartitionRight, but does the bulk of the work with
+blockPartition. Blocks that fall within r[1 .. hi + 1] are moved without being
+compared.
+*/
+template <class It, class Compare = std::less<>>
+size_t expandPartitionRightBlock(It r, size_t hi, size_t rite,
+    Compare less = Compare())
+{
+    assert(hi <= rite);
+    size_t left = 1;
+    const auto pivot = *r;
+    blockPartition(r, pivot, left, rite + 1, hi + 1, rite, 1, rite + 1, less);
+    return hoarePartition(r, left, rite, less) - r;
+}
+
+/**
+Same as expandPartitionLeft, but does the bulk of the work with
+blockPartition. Blocks that fall within r[lo .. pivot] are moved without being
+compared.
+*/
+template <class It, class Compare = std::less<>>
+size_t expandPartitionLeftBlock(It r, size_t lo, size_t pivot,
+    Compare less = Compare())
+{
+    assert(lo > 0 && lo <= pivot);
+    size_t left = 0, rite = pivot - 1;
+    const auto p = r[pivot];
+    blockPartition(r, p, left, pivot, 0, rite, 0, lo, less);
+    // Bring the pivot to the left of what's left to partition, such that
+    // hoarePartition can finish the job.
+    cswap(r[rite + 1], r[pivot]);
+    cswap(r[left], r[rite + 1]);
+    return left
+        + (hoarePartition(r + left, 1, rite + 1 - left, less) - (r + left));
+}
+
+/**
+Same as expandPartition, but does the bulk of the work with blockPartition.
+*/
+template <class It, class Compare = std::less<>>
+size_t expandPartitionBlock(It r, size_t lo, size_t pivot, size_t hi,
+    size_t length, Compare less = Compare())
+{
+    assert(lo <= pivot && pivot < hi && hi <= length);
+    size_t left = 0, rite = length - 1;
+    const auto p = r[pivot];
+    blockPartition(r, p, left, lo, 0, rite, hi, length, less);
+    // Now r[0 .. left] <= r[pivot] <= r[rite + 1 .. length], and one side has
+    // less than a block left. Finish just like expandPartition.
+    --hi;
+    for (;; ++left, --rite)
+    {
+        for (;; ++left)
+        {
+            if (left == lo)
+                return pivot +
+                    expandPartitionRightBlock(r + pivot, hi - pivot,
+                        rite - pivot, less);
+            if (CNT less(r[pivot], r[left])) break;
+        }
+        for (;; --rite)
+        {
+            if (rite == hi)
+                return left +
+                    expandPartitionLeftBlock(r + left, lo - left,
+                        pivot - left, less);
+            if (!(CNT less(r[pivot], r[rite]))) break;
+        }
+        cswap(r[left], r[rite]);
+    }
+}
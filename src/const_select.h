@@ -0,0 +1,145 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include "out_of_core.h"
+
+/**
+Inputs shorter than this are copied whole by constSelect.
+*/
+const size_t constSelectMinLength = 64 * 1024;
+
+/**
+Scratch memory for constSelect. It only ever grows, so once it has served a
+call it serves all calls on inputs up to the same length without allocating.
+*/
+template <class T>
+class SelectionArena
+{
+public:
+    /** Returns room for at least n elements. */
+    T* reserve(size_t n)
+    {
+        if (buf_.size() < n) buf_.resize(n);
+        return buf_.data();
+    }
+    size_t capacity() const { return buf_.size(); }
+
+private:
+    std::vector<T> buf_;
+};
+
+/**
+Arena used by constSelect when the caller doesn't supply one, one per thread.
+*/
+template <class T>
+SelectionArena<T>& threadArena()
+{
+    static thread_local SelectionArena<T> arena;
+    return arena;
+}
+
+/**
+Returns the element of rank k of data[0 .. length] (as if sorted by less)
+without modifying data or copying all of it.
+
+A strided sample of about length^(2/3) elements is selected in the arena to
+find two values that bracket rank k with high probability. Then a single pass
+over data counts the elements below the lower value and copies those between
+the two into the arena, which typically holds a few percent of the input.
+Rank k then falls among the copies, and adaptiveQuickselect finishes there.
+So data is read about once and the arena is written sparingly. If the sample
+was unrepresentative, or the values between the bracket overflow the space
+planned for them, the whole input is copied and selected, which keeps the
+worst case linear.
+*/
+template <class T, class Compare = std::less<>>
+T constSelect(const T* data, size_t length, size_t k, SelectionArena<T>& arena,
+    Compare less = Compare())
+{
+    assert(k < length);
+    const auto selectCopy = [&]
+    {
+        const auto buf = arena.reserve(length);
+        std::copy(data, data + length, buf);
+        adaptiveQuickselect(buf, k, length, less);
+        return buf[k];
+    };
+    if (length < constSelectMinLength) return selectCopy();
+
+    // Bracket rank k with two elements of a sample, about 4 standard
+    // deviations of the sample rank apart from its expected value
+    const size_t m = size_t(std::pow(double(length), 2.0 / 3));
+    const size_t p = std::min(size_t(double(k) * m / length), m - 1);
+    const size_t delta = 2 * size_t(std::sqrt(double(m))) + 1;
+    const size_t cap = std::min(length,
+        2 * (2 * delta + 1) * (length / m + 1));
+    const auto buf = arena.reserve(cap);
+    for (size_t i = 0; i < m; ++i)
+        buf[i] = data[size_t(double(length) * i / m)];
+    SelectionWindow<T> window;
+    if (p + delta < m)
+    {
+        adaptiveQuickselect(buf, p + delta, m, less);
+        window.hi = buf[p + delta];
+        window.hasHi = true;
+    }
+    if (p >= delta)
+    {
+        adaptiveQuickselect(buf, p - delta, std::min(p + delta, m), less);
+        window.lo = buf[p - delta];
+        window.hasLo = true;
+    }
+    const bool single = window.single(less);
+
+    // Filtering pass
+    size_t below = 0, inside = 0;
+    if (window.hasLo && window.hasHi && !single)
+    {
+        // Common case, branch-free: store every element, but only advance
+        // past those inside the window. Chunks are sized so the stores stay
+        // within cap.
+        const auto lo = window.lo, hi = window.hi;
+        for (size_t i = 0; i < length; )
+        {
+            const auto end = std::min(length, i + (cap - inside));
+            if (end == i) return selectCopy();
+            for (; i < end; ++i)
+            {
+                const auto& x = data[i];
+                const bool l = CNT less(x, lo), h = CNT less(hi, x);
+                below += l;
+                buf[inside] = x;
+                inside += !(l | h);
+            }
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < length; ++i)
+        {
+            const auto& x = data[i];
+            if (window.below(x, less)) ++below;
+            else if (window.above(x, less)) continue;
+            else if (single) ++inside;
+            else if (inside < cap) buf[inside++] = x;
+            else return selectCopy();
+        }
+    }
+    if (k < below || k - below >= inside) return selectCopy();
+    if (single) return window.lo;
+    adaptiveQuickselect(buf, k - below, inside, less);
+    return buf[k - below];
+}
+
+/**
+constSelect using the calling thread's arena.
+*/
+template <class T, class Compare = std::less<>>
+T constSelect(const T* data, size_t length, size_t k, Compare less = Compare())
+{
+    return constSelect(data, length, k, threadArena<T>(), less);
+}
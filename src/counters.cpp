@@ -0,0 +1,20 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+// Defines the instrumentation counters declared in common.h, once for every
+// binary that links this file.
+
+#include "common.h"
+
+#ifdef COUNT_SWAPS
+thread_local unsigned long g_swaps = 0;
+#endif
+#ifdef COUNT_WASTED_SWAPS
+thread_local unsigned long g_wastedSwaps = 0;
+#endif
+#ifdef COUNT_COMPARISONS
+thread_local unsigned long g_comparisons = 0;
+#endif
@@ -0,0 +1,137 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include "common.h"
+#include "simd_partition.h"
+#include <algorithm>
+#include <type_traits>
+
+/**
+Number of ninthers gatheredNinthers computes at a time.
+*/
+const size_t ninthersBlock = 64;
+
+namespace generic
+{
+#include "ninther_kernel.h"
+}
+
+#ifdef SIMD_PARTITION_X86
+#pragma GCC push_options
+#pragma GCC target("avx2")
+namespace avx2
+{
+#include "ninther_kernel.h"
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+namespace avx512
+{
+#include "ninther_kernel.h"
+}
+#pragma GCC pop_options
+#endif // SIMD_PARTITION_X86
+
+/**
+Whether sampling through iterator It with comparator Compare can use
+gatheredNinthers: It must be a pointer to an arithmetic type compared by
+operator<, so that min and max give the same medians as the comparator.
+*/
+template <class It, class Compare>
+struct HasGatheredNinthers : std::false_type {};
+template <class T>
+struct HasGatheredNinthers<T*, std::less<>> : std::is_arithmetic<T> {};
+template <class T>
+struct HasGatheredNinthers<T*, std::less<T>> : std::is_arithmetic<T> {};
+
+/**
+Prefetches r[0 .. length] for writing.
+*/
+template <class T>
+inline void prefetchRange(const T* r, size_t length)
+{
+    const size_t step = 64 / sizeof(T);
+    for (size_t i = 0; i < length; i += step)
+        __builtin_prefetch(r + i, 1);
+}
+
+/**
+Computes the same ninthers as the loop of ninthersSample: for each i in
+[lo, hi), with k = 3 * (i - lo), moves into r[i] the ninther of
+r[a + k], r[i - frac], r[b + k], r[a + k + 1], r[i], r[b + k + 1],
+r[a + k + 2], r[i + frac], and r[b + k + 2]. The runs of positions must not
+overlap: b >= hi + frac.
+
+Works on ninthersBlock ninthers at a time: copies their nine rows into a
+buffer, reading each of the five runs of positions sequentially and
+prefetching the next block's, computes the ninthers in the buffer with vector
+min and max, and swaps only the winners that are not yet in place into
+r[lo .. hi]. The positions of different ninthers are disjoint, so the order
+doesn't matter. Each ninther is accounted for as 12 comparisons, the most
+that ninther makes.
+*/
+template <class T>
+void gatheredNinthers(T* r, size_t lo, size_t hi, size_t frac, size_t a,
+    size_t b)
+{
+    assert(lo >= frac && a + 3 * (hi - lo) <= lo - frac && b >= hi + frac);
+#ifdef COUNT_COMPARISONS
+    g_comparisons += 12 * (hi - lo);
+#endif
+    const size_t block = ninthersBlock;
+    alignas(64) T rows[9][block];
+    alignas(64) T medians[block];
+    for (size_t i = lo; i < hi; i += block, a += 3 * block, b += 3 * block)
+    {
+        const size_t count = std::min(block, hi - i);
+        if (const size_t next = std::min(block, hi - i - count))
+        {
+            prefetchRange(r + a + 3 * block, 3 * next);
+            prefetchRange(r + i + block - frac, next);
+            prefetchRange(r + i + block, next);
+            prefetchRange(r + i + block + frac, next);
+            prefetchRange(r + b + 3 * block, 3 * next);
+        }
+        for (size_t j = 0; j < count; ++j)
+        {
+            rows[0][j] = r[a + 3 * j];
+            rows[3][j] = r[a + 3 * j + 1];
+            rows[6][j] = r[a + 3 * j + 2];
+            rows[1][j] = r[i + j - frac];
+            rows[4][j] = r[i + j];
+            rows[7][j] = r[i + j + frac];
+            rows[2][j] = r[b + 3 * j];
+            rows[5][j] = r[b + 3 * j + 1];
+            rows[8][j] = r[b + 3 * j + 2];
+        }
+        switch (simdLevel())
+        {
+#ifdef SIMD_PARTITION_X86
+        case SimdLevel::avx512: avx512::ninthers(rows, medians, count); break;
+        case SimdLevel::avx2: avx2::ninthers(rows, medians, count); break;
+#endif
+        default: generic::ninthers(rows, medians, count); break;
+        }
+        for (size_t j = 0; j < count; ++j)
+        {
+            // As ninther, leave r[i + j] alone if it is the median already
+            const T m = medians[j];
+            if (rows[4][j] == m) continue;
+            size_t row = 0;
+            while (row < 9 && !(rows[row][j] == m)) ++row;
+            // Only unordered values such as NaN match no row
+            if (row == 9) continue;
+            const size_t column = row % 3, k = row / 3;
+            const size_t from = column == 0 ? a + 3 * j + k
+                : column == 1 ? i + j + k * frac - frac
+                : b + 3 * j + k;
+            cswap(r[i + j], r[from]);
+        }
+    }
+}
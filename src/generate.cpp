@@ -0,0 +1,77 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+// Writes a dataset of doubles to stdout, like support/generate.d:
+//
+//     generate --kind=K --n=N [--seed=S] [--min=X] [--max=X]
+//         [--exponent=X] [--distinct=N] [--teeth=N] [--disorder=X]
+//         [--algo=name] >file.dat
+//
+// K is one of generatorKinds (see GeneratorOptions for the other options), or
+// antiqsort for the input on which McIlroy's adversary makes the median
+// selection of the algorithm given by --algo (median_of_ninthers by default)
+// do the most work. For antiqsort, the number of comparisons it made per
+// element goes to stderr.
+
+#include "algorithms.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Value of option name (given as "--name=") in arg, or nullptr
+const char* option(const char* arg, const char* name)
+{
+    const auto length = strlen(name);
+    return strncmp(arg, name, length) == 0 ? arg + length : nullptr;
+}
+
+int main(int argc, char** argv)
+{
+    GeneratorOptions opts;
+    string kind, algo = "median_of_ninthers";
+    size_t n = 10000000;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* v;
+        if ((v = option(argv[i], "--kind="))) kind = v;
+        else if ((v = option(argv[i], "--n="))) n = strtoull(v, nullptr, 10);
+        else if ((v = option(argv[i], "--seed=")))
+            opts.seed = uint32_t(strtoul(v, nullptr, 10));
+        else if ((v = option(argv[i], "--min="))) opts.minValue = atof(v);
+        else if ((v = option(argv[i], "--max="))) opts.maxValue = atof(v);
+        else if ((v = option(argv[i], "--exponent=")))
+            opts.zipfExponent = atof(v);
+        else if ((v = option(argv[i], "--distinct=")))
+            opts.distinct = strtoull(v, nullptr, 10);
+        else if ((v = option(argv[i], "--teeth=")))
+            opts.teeth = strtoull(v, nullptr, 10);
+        else if ((v = option(argv[i], "--disorder=")))
+            opts.disorder = atof(v);
+        else if ((v = option(argv[i], "--algo="))) algo = v;
+        else return 1;
+    }
+    if (kind.empty()) return 1;
+
+    const size_t length = generatedLength(kind.c_str(), n);
+    vector<double> data(length);
+    if (kind == "antiqsort")
+    {
+        const auto comparisons = antiqsortFor(algo, data.data(), n);
+        if (comparisons == 0) return 1;
+        fprintf(stderr, "comparisons: %g\n", double(comparisons) / n);
+    }
+    else if (!generate(kind.c_str(), data.data(), length, opts))
+    {
+        return 1;
+    }
+    if (fwrite(data.data(), sizeof(double), length, stdout) != length)
+        return 5;
+    return fflush(stdout) == 0 ? 0 : 6;
+}
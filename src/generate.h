@@ -0,0 +1,255 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <vector>
+
+/**
+Parameters of the generated distributions, with the defaults of
+support/generate.d where it has them.
+*/
+struct GeneratorOptions
+{
+    // Seed of the pseudorandom kinds, or 0 for an unpredictable one
+    uint32_t seed = 1;
+    // Range of random and normal (within three standard deviations)
+    double minValue = -300000, maxValue = 300000;
+    // Exponent of zipf
+    double zipfExponent = 1.1;
+    // Number of values of fewdistinct
+    size_t distinct = 16;
+    // Number of ascending runs of sawtooth
+    size_t teeth = 16;
+    // Fraction of the elements of nearlysorted swapped out of place
+    double disorder = 0.01;
+};
+
+/**
+Kinds of data generate() knows, ending with nullptr:
+- random: uniform in [minValue, maxValue)
+- random01: half zeros, half ones, and one 0.5 as the median, shuffled
+- sorted: 0, 1, ..., length - 1
+- rotated: 1, 2, ..., length - 1, then 0 (see generatedLength)
+- organpipe: 0 up to length / 2 - 1 and back down
+- m3killer: Musser's median-of-3 killer sequence
+- zipf: ranks 1 to length drawn with probability proportional to
+  rank^-zipfExponent, as word frequencies are
+- normal: mean and standard deviation such that minValue and maxValue are
+  three standard deviations away
+- fewdistinct: integers 0 to distinct - 1 drawn uniformly
+- sawtooth: teeth ascending runs of 0, 1, ...
+- nearlysorted: sorted, then disorder * length random pairs swapped
+*/
+const char* const generatorKinds[] =
+{
+    "random", "random01", "sorted", "rotated", "organpipe", "m3killer",
+    "zipf", "normal", "fewdistinct", "sawtooth", "nearlysorted", nullptr
+};
+
+/**
+Number of doubles in a dataset of the given kind asked for with n elements:
+n, except for rotated, which as in support/generate.d is 1, 2, ..., n followed
+by 0.
+*/
+inline size_t generatedLength(const char* kind, size_t n)
+{
+    return strcmp(kind, "rotated") == 0 ? n + 1 : n;
+}
+
+/**
+Fills out[0 .. length] with data of the given kind (see generatorKinds).
+Returns false if kind is unknown or doesn't allow length: random01 needs an
+even length and m3killer a multiple of 4.
+*/
+inline bool generate(const char* kind, double* out, size_t length,
+    const GeneratorOptions& opts = GeneratorOptions())
+{
+    std::mt19937_64 rng(opts.seed ? opts.seed : std::random_device()());
+    if (strcmp(kind, "random") == 0)
+    {
+        std::uniform_real_distribution<double> dis(opts.minValue,
+            opts.maxValue);
+        for (size_t i = 0; i < length; ++i) out[i] = dis(rng);
+    }
+    else if (strcmp(kind, "random01") == 0)
+    {
+        if (length % 2 != 0) return false;
+        std::fill(out, out + length / 2, 0.0);
+        out[length / 2] = 0.5;
+        std::fill(out + length / 2 + 1, out + length, 1.0);
+        std::shuffle(out, out + length, rng);
+    }
+    else if (strcmp(kind, "sorted") == 0)
+    {
+        for (size_t i = 0; i < length; ++i) out[i] = double(i);
+    }
+    else if (strcmp(kind, "rotated") == 0)
+    {
+        for (size_t i = 0; i < length; ++i) out[i] = double(i + 1);
+        if (length > 0) out[length - 1] = 0;
+    }
+    else if (strcmp(kind, "organpipe") == 0)
+    {
+        const size_t half = length / 2;
+        for (size_t i = 0; i < half; ++i)
+            out[i] = out[length - 1 - i] = double(i);
+        if (length % 2 != 0) out[half] = double(half);
+    }
+    else if (strcmp(kind, "m3killer") == 0)
+    {
+        if (length % 4 != 0) return false;
+        const size_t k = length / 2;
+        for (size_t i = 1; i <= k; ++i)
+        {
+            out[i - 1] = double(i & 1 ? i : k + i - 1);
+            out[k + i - 1] = double(2 * i);
+        }
+    }
+    else if (strcmp(kind, "zipf") == 0)
+    {
+        // Inversion of the cumulative distribution, tabulated
+        std::vector<double> cdf(length);
+        double sum = 0;
+        for (size_t i = 0; i < length; ++i)
+            cdf[i] = sum += pow(double(i + 1), -opts.zipfExponent);
+        std::uniform_real_distribution<double> dis(0, sum);
+        for (size_t i = 0; i < length; ++i)
+        {
+            const auto rank = std::upper_bound(cdf.begin(), cdf.end(),
+                dis(rng)) - cdf.begin();
+            out[i] = double(std::min(size_t(rank), length - 1) + 1);
+        }
+    }
+    else if (strcmp(kind, "normal") == 0)
+    {
+        std::normal_distribution<double> dis(
+            (opts.minValue + opts.maxValue) / 2,
+            (opts.maxValue - opts.minValue) / 6);
+        for (size_t i = 0; i < length; ++i) out[i] = dis(rng);
+    }
+    else if (strcmp(kind, "fewdistinct") == 0)
+    {
+        std::uniform_int_distribution<size_t> dis(0,
+            std::max<size_t>(opts.distinct, 1) - 1);
+        for (size_t i = 0; i < length; ++i) out[i] = double(dis(rng));
+    }
+    else if (strcmp(kind, "sawtooth") == 0)
+    {
+        const size_t period = std::max<size_t>(
+            length / std::max<size_t>(opts.teeth, 1), 1);
+        for (size_t i = 0; i < length; ++i) out[i] = double(i % period);
+    }
+    else if (strcmp(kind, "nearlysorted") == 0)
+    {
+        for (size_t i = 0; i < length; ++i) out[i] = double(i);
+        if (length == 0) return true;
+        std::uniform_int_distribution<size_t> dis(0, length - 1);
+        for (auto swaps = size_t(opts.disorder * length); swaps > 0; --swaps)
+            std::swap(out[dis(rng)], out[dis(rng)]);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+/**
+McIlroy's adversary for quicksort-like algorithms (M. D. McIlroy, "A Killer
+Adversary for Quicksort", 1999), which decides the outcome of each comparison
+while the algorithm runs. All elements start out as "gas", greater than
+anything else and of unknown order among themselves. Comparing two gas
+elements freezes one of them (the likeliest pivot: the gas element last
+compared) to the smallest value not yet given out, so pivots tend to be
+extremes. The values given out form an input on which the algorithm, if
+deterministic, makes the very same comparisons; the remaining gas elements
+all get the largest value.
+
+The comparisons of concurrent threads are serialized, which keeps the values
+consistent although they then depend on the order in which threads run.
+*/
+class AntiqsortAdversary
+{
+public:
+    explicit AntiqsortAdversary(size_t length)
+        : values_(length, length), gas_(length)
+    {
+    }
+
+    /** Whether element a compares less than element b. */
+    bool less(size_t a, size_t b)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++comparisons_;
+        if (values_[a] == gas_ && values_[b] == gas_)
+            values_[a == candidate_ ? a : b] = solid_++;
+        if (values_[a] == gas_) candidate_ = a;
+        else if (values_[b] == gas_) candidate_ = b;
+        return values_[a] < values_[b];
+    }
+
+    size_t comparisons() const { return comparisons_; }
+
+    /** Writes the value of each element, in its original order, to out. */
+    void values(double* out) const
+    {
+        for (size_t i = 0; i < values_.size(); ++i) out[i] = double(values_[i]);
+    }
+
+private:
+    std::vector<size_t> values_;
+    const size_t gas_;
+    size_t solid_ = 0, candidate_ = 0, comparisons_ = 0;
+    std::mutex mutex_;
+};
+
+/**
+Key whose comparisons are decided by the adversary set for antiqsort; index is
+the element's position in the input.
+*/
+struct AdversaryKey
+{
+    size_t index;
+
+    static AntiqsortAdversary*& adversary()
+    {
+        static AntiqsortAdversary* result = nullptr;
+        return result;
+    }
+
+    friend bool operator<(const AdversaryKey& a, const AdversaryKey& b)
+    {
+        return adversary()->less(a.index, b.index);
+    }
+};
+
+/**
+Builds in out[0 .. length] an input on which select(b, b + n, b + length), a
+selection function like the computeSelection of the benchmarks, makes as many
+comparisons as McIlroy's adversary can force, by running it on AdversaryKeys.
+Returns the number of comparisons, which select makes on out again if it is
+deterministic. Not reentrant.
+*/
+template <class Select>
+size_t antiqsort(double* out, size_t length, size_t n, Select select)
+{
+    AntiqsortAdversary adversary(length);
+    std::vector<AdversaryKey> keys(length);
+    for (size_t i = 0; i < length; ++i) keys[i].index = i;
+    AdversaryKey::adversary() = &adversary;
+    const auto b = keys.data();
+    select(b, b + n, b + length);
+    AdversaryKey::adversary() = nullptr;
+    adversary.values(out);
+    return adversary.comparisons();
+}
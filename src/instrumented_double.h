@@ -23,7 +23,7 @@ public:
     friend inline bool operator<(const Double& a, const Double& b)
     {
 #ifdef COUNT_COMPARISONS
-        extern unsigned long g_comparisons;
+        extern thread_local unsigned long g_comparisons;
         ++g_comparisons;
 #endif
         return a.payload < b.payload;
@@ -32,11 +32,11 @@ public:
     void swap(Double & b)
     {
 #ifdef COUNT_SWAPS
-        extern unsigned long g_swaps;
+        extern thread_local unsigned long g_swaps;
         ++g_swaps;
 #endif
 #ifdef COUNT_WASTED_SWAPS
-        extern unsigned long g_wastedSwaps;
+        extern thread_local unsigned long g_wastedSwaps;
         if (payload == b.payload) ++g_wastedSwaps;
 #endif
         auto t = payload;
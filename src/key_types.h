@@ -0,0 +1,106 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+Large record selected by its leading key, as when sorting rows of a table:
+swaps move 128 bytes while comparisons read 8.
+*/
+struct FatRecord
+{
+    double key;
+    char payload[120];
+
+    friend bool operator<(const FatRecord& a, const FatRecord& b)
+    {
+        return a.key < b.key;
+    }
+};
+
+/**
+Key types: name() as given to --types, and make(x, rank), which builds the
+key for a double x of the given rank among the distinct values of its file.
+Ranks keep the order of the dataset exactly in types that can't hold every
+double (up to 2^24 distinct values for float).
+*/
+template <class T> struct KeyType;
+
+template <> struct KeyType<int32_t>
+{
+    static const char* name() { return "int32"; }
+    static int32_t make(double, size_t rank) { return int32_t(rank); }
+};
+
+template <> struct KeyType<int64_t>
+{
+    static const char* name() { return "int64"; }
+    static int64_t make(double, size_t rank) { return int64_t(rank); }
+};
+
+template <> struct KeyType<float>
+{
+    static const char* name() { return "float"; }
+    static float make(double, size_t rank) { return float(rank); }
+};
+
+template <> struct KeyType<double>
+{
+    static const char* name() { return "double"; }
+    static double make(double x, size_t) { return x; }
+};
+
+// Short strings (within the small string optimization of common libraries)
+// with a long common prefix, so comparisons scan several bytes
+template <> struct KeyType<std::string>
+{
+    static const char* name() { return "string"; }
+    static std::string make(double, size_t rank)
+    {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "k%012zu", rank);
+        return buf;
+    }
+};
+
+template <> struct KeyType<FatRecord>
+{
+    static const char* name() { return "record"; }
+    static FatRecord make(double x, size_t rank)
+    {
+        FatRecord result;
+        result.key = x;
+        memset(result.payload, int(rank & 0xFF), sizeof(result.payload));
+        return result;
+    }
+};
+
+/**
+Converts the doubles raw[0 .. length] of a dataset to keys of type T in
+out[0 .. length], by way of their ranks among the distinct values. distinct is
+scratch space.
+*/
+template <class T>
+void makeKeys(const double* raw, size_t length, T* out,
+    std::vector<double>& distinct)
+{
+    distinct.assign(raw, raw + length);
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()),
+        distinct.end());
+    for (size_t i = 0; i < length; ++i)
+    {
+        const size_t rank = std::lower_bound(distinct.begin(), distinct.end(),
+            raw[i]) - distinct.begin();
+        out[i] = KeyType<T>::make(raw[i], rank);
+    }
+}
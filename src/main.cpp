@@ -5,23 +5,42 @@
  */
 
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <algorithm>
 #include <random>
 #include <sys/stat.h>
 #include "timer.h"
+#include "mapped_array.h"
+#include "page_buffer.h"
+#include "perf_counters.h"
+#include "radix_select.h"
 using namespace std;
 
 extern void (*computeSelection)(double*, double*, double*);
-#ifdef COUNT_SWAPS
-unsigned long g_swaps = 0;
-#endif
-#ifdef COUNT_WASTED_SWAPS
-unsigned long g_wastedSwaps = 0;
-#endif
-#ifdef COUNT_COMPARISONS
-unsigned long g_comparisons = 0;
-#endif
+// Optionally defined by algorithms that pick an implementation at runtime
+extern const char* selectionVariant() __attribute__((weak));
+// Optionally defined by algorithms that place several order statistics at once
+extern void (*computeMultiselection)(double*, double*, const size_t*, size_t)
+    __attribute__((weak));
+// Optionally defined by algorithms that sort the smallest elements: like
+// computeSelection, but also sorts the range before the second argument
+extern void (*computePartialSort)(double*, double*, double*)
+    __attribute__((weak));
+// Optionally defined by algorithms that select without modifying their input:
+// returns the element of rank k (the last argument) of the first argument
+extern double (*computeConstSelection)(const double*, size_t, size_t)
+    __attribute__((weak));
+// Optionally defined by algorithms that select from data that may not fit in
+// memory: returns the element of rank k of the first argument, keeping at most
+// about as many bytes as the last argument in memory
+extern double (*computeOutOfCoreSelection)(const double*, size_t, size_t,
+    OutOfCoreStats&, size_t) __attribute__((weak));
+// Optionally defined by algorithms that select approximately: like
+// computeSelection, but may place an element of another rank, within the
+// tolerance given by the last argument times the length; returns its position
+extern size_t (*computeApproximateSelection)(double*, double*, double*, double)
+    __attribute__((weak));
 
 double avg(const double* b, const double*const e)
 {
@@ -44,9 +63,160 @@ double stddev(const double* b, const double* e, double avg)
     return sqrt(result / size);
 }
 
+// What each epoch computes: the median via computeSelection (the default),
+// or the percentiles below via computeMultiselection, via one
+// computeSelection call per percentile, or via a full sort. The last three
+// modes sort the topK smallest elements via computePartialSort, via
+// std::partial_sort, or via computeSelection followed by std::sort. The
+// const mode selects the median via computeConstSelection on the original
+// data, and the copy mode does so by copying the data (within the timing) and
+// calling computeSelection on the copy. The approx mode places an element of
+// rank near the median via computeApproximateSelection, with the rank tolerance
+// given after the mode.
+enum class Mode
+{
+    select, multiselect, repeated, sort, topk, partialSort, selectSort,
+    constSelect, copySelect, approx
+};
+
+// Percentiles computed by the multiselect, repeated, and sort modes
+const double percentiles[] = { 0.5, 0.9, 0.99, 0.999 };
+const size_t percentileCount = sizeof(percentiles) / sizeof(*percentiles);
+
+// Number of smallest elements sorted by the top-k modes
+const size_t topK = 1000;
+
+// Set by --radix: computeSelection is given only the range that radixNarrow
+// leaves around the sought rank, as in radixSelect
+bool radixFirst = false;
+
+// Same as computeSelection(b, k, e), but narrows the range first if
+// radixFirst is set
+void selectRank(double* b, double* k, double* e)
+{
+    const size_t length = e - b;
+    if (radixFirst && length >= radixSelectThreshold)
+    {
+        const auto middle = radixNarrow(b, k - b, length, less<>(),
+            true_type());
+        if (middle.second - middle.first == 1) return;
+        e = b + middle.second;
+        b += middle.first;
+    }
+    (*computeSelection)(b, k, e);
+}
+
+// Selects the median of a file mapped in memory with computeOutOfCoreSelection
+// instead of loading it, using the memory budget given by defaultMemoryBudget.
+// The result is verified by streaming over the file once more.
+int runOutOfCore(const char* path)
+{
+    if (!&computeOutOfCoreSelection) return 9;
+#ifdef MEASURE_TIME
+    const size_t epochs = 12;
+    const size_t outlierEpochs = 2;
+#else
+    const size_t epochs = 1;
+    const size_t outlierEpochs = 0;
+#endif
+    size_t dataLen;
+    const auto data = mapArray<double>(path, dataLen);
+    if (!data) return 2;
+    const auto budget = defaultMemoryBudget();
+    const size_t index = dataLen / 2;
+
+    double durations[epochs];
+    double median = 0;
+    OutOfCoreStats stats;
+    for (size_t i = 0; i < epochs; ++i)
+    {
+        stats = OutOfCoreStats();
+        //////////////////// TIMING {
+        Timer t;
+        const auto m = (*computeOutOfCoreSelection)(data, dataLen, index,
+            stats, budget);
+        durations[i] = t.elapsed();
+        //////////////////// } TIMING
+        if (i > 0 && m != median) return 7;
+        median = m;
+    }
+
+    // Verify: index must fall among the elements equal to the median
+    size_t less = 0, equal = 0;
+    for (size_t i = 0; i < dataLen; ++i)
+    {
+        less += data[i] < median;
+        equal += data[i] == median;
+    }
+    unmapArray(data, dataLen);
+    if (index < less || index >= less + equal) return 8;
+
+    sort(durations, durations + epochs);
+#ifdef MEASURE_TIME
+    const size_t experiments = epochs - outlierEpochs;
+    const double avg1 = avg(durations, durations + experiments);
+    printf("milliseconds: %g\n", avg1);
+    const double stddev1 = stddev(durations, durations + experiments, avg1);
+    printf("stddev: %g\n", stddev1);
+    printf("rsd: %g\n", stddev1 / avg1);
+#else
+    (void) outlierEpochs;
+#endif
+    printf("size: %lu\nmedian: %g\n", dataLen, median);
+    printf("memory_budget: %lu\n", budget);
+    printf("peak_bytes: %lu\n", stats.peakBytes);
+    printf("bytes_read: %lu\n", stats.bytesRead);
+    printf("passes: %lu\n", stats.passes);
+    return 0;
+}
+
 int main(int argc, char** argv)
 {
-    if (argc != 2) return 1;
+    // Take out --radix and the options of the input and work buffers (see
+    // BufferOptions), leaving the positional arguments
+    BufferOptions bufferOptions;
+    int positional = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strncmp(argv[i], "--", 2) != 0) argv[positional++] = argv[i];
+        else if (strcmp(argv[i], "--radix") == 0) radixFirst = true;
+        else if (!parseBufferOption(argv[i], bufferOptions)) return 1;
+    }
+    argc = positional;
+    if (argc < 2 || argc > 4) return 1;
+    if (argc == 4 && strcmp(argv[2], "approx") != 0) return 1;
+    if (argc == 3 && strcmp(argv[2], "outofcore") == 0)
+        return runOutOfCore(argv[1]);
+    auto mode = Mode::select;
+    double tolerance = 0;
+    if (argc == 4)
+    {
+        mode = Mode::approx;
+        char* end;
+        tolerance = strtod(argv[3], &end);
+        if (*end || !(tolerance >= 0)) return 1;
+    }
+    else if (argc == 3)
+    {
+        if (strcmp(argv[2], "multiselect") == 0) mode = Mode::multiselect;
+        else if (strcmp(argv[2], "repeated") == 0) mode = Mode::repeated;
+        else if (strcmp(argv[2], "sort") == 0) mode = Mode::sort;
+        else if (strcmp(argv[2], "topk") == 0) mode = Mode::topk;
+        else if (strcmp(argv[2], "partial_sort") == 0)
+            mode = Mode::partialSort;
+        else if (strcmp(argv[2], "select_sort") == 0) mode = Mode::selectSort;
+        else if (strcmp(argv[2], "const") == 0) mode = Mode::constSelect;
+        else if (strcmp(argv[2], "copy") == 0) mode = Mode::copySelect;
+        else if (strcmp(argv[2], "select") != 0) return 1;
+    }
+    if (mode == Mode::multiselect && !&computeMultiselection) return 9;
+    if (mode == Mode::topk && !&computePartialSort) return 9;
+    if (mode == Mode::constSelect && !&computeConstSelection) return 9;
+    if (mode == Mode::approx && !&computeApproximateSelection) return 9;
+    const bool percentileMode = mode == Mode::multiselect
+        || mode == Mode::repeated || mode == Mode::sort;
+    const bool topKMode = mode == Mode::topk || mode == Mode::partialSort
+        || mode == Mode::selectSort;
 
     // Is this file random? If so, we should randomInput after each run
     const bool randomInput = strstr(argv[1], "random") != nullptr;
@@ -65,7 +235,10 @@ int main(int argc, char** argv)
     if (stat(argv[1], &stat_buf) != 0) return 2;
     if (stat_buf.st_size == 0 || stat_buf.st_size % 8 != 0) return 3;
     const size_t dataLen = stat_buf.st_size / 8;
-    auto data = new double[dataLen];
+    PageBuffer<double> input(dataLen, bufferOptions);
+    const auto data = input.data();
+    // Restored from data before each epoch
+    PageBuffer<double> work(dataLen, bufferOptions);
     const auto f = fopen(argv[1], "rb");
     if (!f) return 4;
     if (fread(data, sizeof(double), dataLen, f) != dataLen) return 5;
@@ -73,38 +246,118 @@ int main(int argc, char** argv)
 
     // The fraction we're searching for (2 for median)
     const size_t frac = 2;
-    // The order statistic we're looking for
-    size_t index = dataLen / frac;
+    // The order statistic we're looking for, or the last one sorted
+    const size_t sorted = min(topK, dataLen);
+    size_t index = topKMode ? sorted - 1 : dataLen / frac;
+    // Ranks of the percentiles, sorted as computeMultiselection requires
+    size_t ranks[percentileCount];
+    for (size_t i = 0; i < percentileCount; ++i)
+        ranks[i] = min(size_t(dataLen * percentiles[i]), dataLen - 1);
 
     std::random_device rd;
     std::mt19937 g(1);
 
     double durations[epochs];
     double median = 0;
+    double results[percentileCount] = {};
+    // Elements placed by each selection of the repeated mode
+    double repeatedResults[percentileCount] = {};
+    vector<double> prefix;
+    // Positions placed by the approx mode, and the elements placed there
+    vector<size_t> positions;
+    vector<double> placed;
 #ifdef COUNT_COMPARISONS
     unsigned long maxComparisons = 0;
 #endif
+#ifdef MEASURE_TIME
+    // Hardware events over the timed regions, where available
+    PerfCounters counters;
+#endif
 
     for (size_t i = 0; i < epochs; ++i)
     {
         if (randomInput && i > 0)
             shuffle(data, data + dataLen, g);
 
-        vector<double> v {data, data + dataLen};
-        auto b = &v[0];
+        const auto v = work.data();
+        copy(data, data + dataLen, v);
+        auto b = v;
 
 #ifdef COUNT_COMPARISONS
         const auto tally = g_comparisons;
 #endif
 
         //////////////////// TIMING {
+#ifdef MEASURE_TIME
+        counters.start();
+#endif
         Timer t;
-        (*computeSelection)(b, b + index, b + dataLen);
+        switch (mode)
+        {
+        case Mode::select:
+            selectRank(b, b + index, b + dataLen);
+            break;
+        case Mode::multiselect:
+            (*computeMultiselection)(b, b + dataLen, ranks, percentileCount);
+            break;
+        case Mode::repeated:
+            for (size_t j = 0; j < percentileCount; ++j)
+            {
+                selectRank(b, b + ranks[j], b + dataLen);
+                repeatedResults[j] = b[ranks[j]];
+            }
+            break;
+        case Mode::sort:
+            sort(b, b + dataLen);
+            break;
+        case Mode::topk:
+            (*computePartialSort)(b, b + sorted, b + dataLen);
+            break;
+        case Mode::partialSort:
+            partial_sort(b, b + sorted, b + dataLen);
+            break;
+        case Mode::selectSort:
+            selectRank(b, b + index, b + dataLen);
+            sort(b, b + index);
+            break;
+        case Mode::constSelect:
+            // Store the result in v so the checks below apply
+            v[index] = (*computeConstSelection)(data, dataLen, index);
+            break;
+        case Mode::copySelect:
+            copy(data, data + dataLen, b);
+            selectRank(b, b + index, b + dataLen);
+            break;
+        case Mode::approx:
+            positions.push_back((*computeApproximateSelection)(b, b + index,
+                b + dataLen, tolerance));
+            break;
+        }
         durations[i] = t.elapsed();
+#ifdef MEASURE_TIME
+        counters.stop();
+#endif
         //////////////////// } TIMING
 
+        // Each selection of the repeated mode may move the elements placed
+        // by the previous ones; put them back so the checks below apply
+        if (mode == Mode::repeated)
+            for (size_t j = 0; j < percentileCount; ++j)
+                v[ranks[j]] = repeatedResults[j];
+
         // Verify consistency
-        if (median == 0)
+        if (mode == Mode::approx)
+        {
+            // The element placed must be in its sorted place; its rank may
+            // vary across shuffles
+            const auto p = positions.back();
+            if (p >= dataLen || double(max(p, index) - min(p, index))
+                > tolerance * dataLen) return 7;
+            for (size_t j = 0; j < dataLen; ++j)
+                if (j < p ? v[p] < v[j] : v[j] < v[p]) return 7;
+            placed.push_back(v[p]);
+        }
+        else if (median == 0)
         {
             median = v[index];
         }
@@ -112,6 +365,20 @@ int main(int argc, char** argv)
         {
             if (median != v[index]) return 7;
         }
+        if (topKMode)
+        {
+            if (i == 0) prefix.assign(b, b + sorted);
+            else if (!equal(prefix.begin(), prefix.end(), b)) return 7;
+            if (!is_sorted(b, b + sorted)) return 7;
+        }
+        else if (percentileMode)
+        {
+            for (size_t j = 0; j < percentileCount; ++j)
+            {
+                if (i == 0) results[j] = v[ranks[j]];
+                else if (results[j] != v[ranks[j]]) return 7;
+            }
+        }
 
 #ifdef COUNT_COMPARISONS
         maxComparisons = max(g_comparisons - tally, maxComparisons);
@@ -121,7 +388,22 @@ int main(int argc, char** argv)
     // Verify
     vector<double> v {data, data + dataLen};
     sort(v.begin(), v.end());
-    if (median != v[index]) return 8;
+    if (mode == Mode::approx)
+    {
+        for (size_t j = 0; j < epochs; ++j)
+            if (placed[j] != v[positions[j]]) return 8;
+        median = placed[0];
+    }
+    else if (median != v[index]) return 8;
+    if (topKMode)
+    {
+        if (!equal(prefix.begin(), prefix.end(), v.begin())) return 8;
+    }
+    else if (percentileMode)
+    {
+        for (size_t j = 0; j < percentileCount; ++j)
+            if (results[j] != v[ranks[j]]) return 8;
+    }
 
     // Print results
     sort(durations, durations + epochs);
@@ -134,9 +416,41 @@ int main(int argc, char** argv)
     printf("stddev: %g\n", stddev1);
     // Relative standard deviation
     printf("rsd: %g\n", stddev1 / avg1);
+    // Events per element, or a note that there are none
+    for (size_t j = 0; j < perfEventCount; ++j)
+        if (counters.available(j))
+            printf("%s: %g\n", perfEventNames[j],
+                counters.total(j) / (epochs * dataLen));
+    if (!counters.anyAvailable()) printf("perf_counters: unavailable\n");
 #endif
     printf("size: %lu\nmedian: %g\n", dataLen, median);
     if (randomInput) printf("shuffled: 1\n");
+    if (bufferOptions.pages != PageKind::standard)
+        printf("pages: %s\n", pageKindNames[int(work.pages())]);
+    if (bufferOptions.placement != Placement::local)
+        printf("placement: %s\n", placementNames[int(bufferOptions.placement)]);
+    if (selectionVariant) printf("variant: %s\n", selectionVariant());
+    if (topKMode) printf("top_k: %lu\n", sorted);
+    else if (mode == Mode::approx)
+    {
+        // Distance of the rank achieved from the median, as a fraction of
+        // the length
+        double error = 0, maxError = 0;
+        for (auto p : positions)
+        {
+            const double e = double(max(p, index) - min(p, index)) / dataLen;
+            error += e;
+            maxError = max(e, maxError);
+        }
+        printf("tolerance: %g\nrank: %lu\n", tolerance, positions[0]);
+        printf("rank_error: %g\n", error / epochs);
+        printf("max_rank_error: %g\n", maxError);
+    }
+    else if (percentileMode)
+    {
+        for (size_t j = 0; j < percentileCount; ++j)
+            printf("p%g: %g\n", percentiles[j] * 100, results[j]);
+    }
 #ifdef COUNT_COMPARISONS
     printf("comparisons: %g\n", double(g_comparisons) / (epochs * dataLen));
     printf("max_comparisons: %g\n",
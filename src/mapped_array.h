@@ -0,0 +1,79 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+Maps the file at path read-only as an array of T and stores its element count
+in length. Returns nullptr if the file cannot be mapped or its size is not a
+nonzero multiple of sizeof(T). Release with unmapArray.
+*/
+template <class T>
+const T* mapArray(const char* path, size_t& length)
+{
+    const auto fd = open(path, O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0 || st.st_size % sizeof(T) != 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+    const auto p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return nullptr;
+    // Data is mostly streamed through
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+    length = st.st_size / sizeof(T);
+    return static_cast<const T*>(p);
+}
+
+template <class T>
+void unmapArray(const T* data, size_t length)
+{
+    munmap(const_cast<T*>(data), length * sizeof(T));
+}
+
+/**
+Memory budget (in bytes) of outOfCoreSelect: the value of the environment
+variable SELECTION_MEMORY if set (with an optional K, M, or G suffix),
+otherwise 64 MiB.
+*/
+inline size_t defaultMemoryBudget()
+{
+    if (auto s = getenv("SELECTION_MEMORY"))
+    {
+        char* suffix;
+        auto n = strtoull(s, &suffix, 10);
+        switch (*suffix)
+        {
+        case 'G': case 'g': n <<= 10; // fall through
+        case 'M': case 'm': n <<= 10; // fall through
+        case 'K': case 'k': n <<= 10;
+        }
+        if (n > 0) return n;
+    }
+    return size_t(64) << 20;
+}
+
+/**
+Counters reported by outOfCoreSelect.
+*/
+struct OutOfCoreStats
+{
+    // Full sequential passes over the input
+    size_t passes = 0;
+    // Bytes of input read, including sampling
+    size_t bytesRead = 0;
+    // Largest buffer held in memory, in bytes
+    size_t peakBytes = 0;
+};
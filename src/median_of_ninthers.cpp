@@ -5,6 +5,8 @@
  */
 
 #include "median_of_ninthers.h"
+#include "const_select.h"
+#include "out_of_core.h"
 
 template <class T>
 static void quickselect(T* beg, T* mid, T* end)
@@ -16,3 +18,48 @@ static void quickselect(T* beg, T* mid, T* end)
 
 void (*computeSelection)(double*, double*, double*)
     = &quickselect<double>;
+
+template <class T>
+static void multiselect(T* beg, T* end, const size_t* ks, size_t count)
+{
+    ::multiselect(beg, end - beg, ks, count);
+}
+
+void (*computeMultiselection)(double*, double*, const size_t*, size_t)
+    = &multiselect<double>;
+
+template <class T>
+static void partialSort(T* beg, T* mid, T* end)
+{
+    adaptivePartialSort(beg, mid - beg, end - beg);
+}
+
+void (*computePartialSort)(double*, double*, double*) = &partialSort<double>;
+
+template <class T>
+static T outOfCoreSelection(const T* data, size_t length, size_t k,
+    OutOfCoreStats& stats, size_t budgetBytes)
+{
+    return outOfCoreSelect(data, length, k, budgetBytes, stats);
+}
+
+double (*computeOutOfCoreSelection)(const double*, size_t, size_t,
+    OutOfCoreStats&, size_t) = &outOfCoreSelection<double>;
+
+template <class T>
+static T constSelection(const T* data, size_t length, size_t k)
+{
+    return constSelect(data, length, k);
+}
+
+double (*computeConstSelection)(const double*, size_t, size_t)
+    = &constSelection<double>;
+
+template <class T>
+static size_t approximateSelection(T* beg, T* mid, T* end, double tolerance)
+{
+    return approximateQuickselect(beg, mid - beg, end - beg, tolerance);
+}
+
+size_t (*computeApproximateSelection)(double*, double*, double*, double)
+    = &approximateSelection<double>;
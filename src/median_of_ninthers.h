@@ -6,18 +6,87 @@
 
 #pragma once
 #include "common.h"
+#include "gathered_sampling.h"
+#include "radix_select.h"
+#include "simd_partition.h"
+#include "tuning.h"
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/**
+Partitioning primitives used by adaptiveQuickselect. HoarePartitioner uses the
+classic scalar loops, BlockPartitioner their branch-free block counterparts,
+and SimdPartitioner vectorized kernels for arithmetic types (falling back to
+BlockPartitioner otherwise). All offer the same output guarantees.
+*/
+struct HoarePartitioner
+{
+    template <class It, class Compare>
+    static size_t expandPartition(It r, size_t lo, size_t pivot, size_t hi,
+        size_t length, Compare less)
+    {
+        return ::expandPartition(r, lo, pivot, hi, length, less);
+    }
+};
+
+struct BlockPartitioner
+{
+    template <class It, class Compare>
+    static size_t expandPartition(It r, size_t lo, size_t pivot, size_t hi,
+        size_t length, Compare less)
+    {
+        return expandPartitionBlock(r, lo, pivot, hi, length, less);
+    }
+};
+
+struct SimdPartitioner
+{
+    template <class It, class Compare>
+    static size_t expandPartition(It r, size_t lo, size_t pivot, size_t hi,
+        size_t length, Compare less)
+    {
+        return expandPartitionSimd(r, lo, pivot, hi, length, less);
+    }
+};
+
+/**
+Partitioner P, with the ninthers of medianOfNinthers computed by
+gatheredNinthers where the keys allow it.
+*/
+template <class P>
+struct GatheredSampling : P {};
+
+template <class P>
+struct IsGatheredSampling : std::false_type {};
+template <class P>
+struct IsGatheredSampling<GatheredSampling<P>> : std::true_type {};
+
+/**
+Arrays at least this long are narrowed by a Floyd-Rivest step (see
+floydRivest) instead of being partitioned with medianOfNinthers when the
+sought rank is not close to either end, in approximateQuickselect and
+SelectionIndex. adaptiveQuickselect takes its threshold as an argument.
+*/
+const size_t floydRivestThreshold = 1024 * 1024;
+
+/**
+Smallest array length for which floydRivest can be used at all.
+*/
+const size_t floydRivestMinLength = 1024;
 
 template <class T>
 size_t partitionImpl(T* beg, size_t length);
-template <class T>
-void adaptiveQuickselect(T* beg, size_t n, size_t length);
+template <class P = HoarePartitioner, class It, class Compare = std::less<>>
+void adaptiveQuickselect(It beg, size_t n, size_t length,
+    Compare less = Compare(), size_t samplingThreshold = SIZE_MAX);
 
 /**
 Median of minima
 */
-template <class T>
-size_t medianOfMinima(T*const r, const size_t n, const size_t length)
+template <class P, class It, class Compare>
+size_t medianOfMinima(const It r, const size_t n, const size_t length,
+    Compare less)
 {
     assert(length >= 2);
     assert(n * 4 <= length);
@@ -30,21 +99,22 @@ size_t medianOfMinima(T*const r, const size_t n, const size_t length)
         const auto limit = j + computeMinOver;
         size_t minIndex = j;
         while (++j < limit)
-            if (r[j] <CNT r[minIndex])
+            if (CNT less(r[j], r[minIndex]))
                 minIndex = j;
-        if (r[minIndex] <CNT r[i])
+        if (CNT less(r[minIndex], r[i]))
             cswap(r[i], r[minIndex]);
         assert(j < length || i + 1 == subset);
     }
-    adaptiveQuickselect(r, n, subset);
-    return expandPartition(r, 0, n, subset, length);
+    adaptiveQuickselect<P>(r, n, subset, less);
+    return P::expandPartition(r, 0, n, subset, length, less);
 }
 
 /**
 Median of maxima
 */
-template <class T>
-size_t medianOfMaxima(T*const r, const size_t n, const size_t length)
+template <class P, class It, class Compare>
+size_t medianOfMaxima(const It r, const size_t n, const size_t length,
+    Compare less)
 {
     assert(length >= 2);
     assert(n * 4 >= length * 3 && n < length);
@@ -58,92 +128,475 @@ size_t medianOfMaxima(T*const r, const size_t n, const size_t length)
         const auto limit = j + computeMaxOver;
         size_t maxIndex = j;
         while (++j < limit)
-            if (r[j] >CNT r[maxIndex])
+            if (CNT less(r[maxIndex], r[j]))
                 maxIndex = j;
-        if (r[maxIndex] >CNT r[i])
+        if (CNT less(r[i], r[maxIndex]))
             cswap(r[i], r[maxIndex]);
         assert(j != 0 || i + 1 == length);
     }
-    adaptiveQuickselect(r + subsetStart, length - n, subset);
-    return expandPartition(r, subsetStart, n, length, length);
+    adaptiveQuickselect<P>(r + subsetStart, length - n, subset, less);
+    return P::expandPartition(r, subsetStart, n, length, length, less);
 }
 
 /**
-Partitions r[0 .. length] using a pivot of its own choosing. Attempts to pick a
-pivot that approximates the median. Returns the position of the pivot.
+The ninthers of ninthersSample, one at a time or gathered (see
+gatheredNinthers).
 */
-template <class T>
-size_t medianOfNinthers(T*const r, const size_t length)
+template <class It, class Compare>
+void sampleNinthers(It r, size_t lo, size_t hi, size_t frac, size_t a,
+    size_t b, Compare less, std::false_type)
+{
+    for (size_t i = lo; i < hi; ++i, a += 3, b += 3)
+    {
+        ninther(r, a, i - frac, b, a + 1, i, b + 1, a + 2, i + frac, b + 2,
+            less);
+    }
+}
+
+template <class T, class Compare>
+void sampleNinthers(T* r, size_t lo, size_t hi, size_t frac, size_t a,
+    size_t b, Compare less, std::true_type)
+{
+    // With fractions over length / 13, as on arrays of up to mediumLength,
+    // the positions of later ninthers overlap those of earlier ones, so they
+    // must go in order
+    if (b < hi + frac)
+        return sampleNinthers(r, lo, hi, frac, a, b, less, std::false_type());
+    gatheredNinthers(r, lo, hi, frac, a, b);
+}
+
+/**
+Sampling step of medianOfNinthers: moves frac ninthers of r[0 .. length] to
+r[lo .. lo + frac], where lo = length / 2 - frac / 2, and their median to
+r[lo + frac / 2], leaving smaller ones before it and greater ones after.
+Returns frac.
+*/
+template <class P, class It, class Compare>
+size_t ninthersSample(const It r, const size_t length, Compare less)
 {
     assert(length >= 12);
-    const auto frac =
-        length <= 1024 ? length / 12 :
-        length <= 128 * 1024 ? length / 64
-        : length / 1024;
+    using T = typename std::iterator_traits<It>::value_type;
+    const auto frac = ninthersFraction(tuning<T>(), length);
     auto pivot = frac / 2;
     const auto lo = length / 2 - pivot, hi = lo + frac;
     assert(lo >= frac * 4);
     assert(length - hi >= frac * 4);
     assert(lo / 2 >= pivot);
     const auto gap = (length - 9 * frac) / 4;
-    auto a = lo - 4 * frac - gap, b = hi + gap;
-    for (size_t i = lo; i < hi; ++i, a += 3, b += 3)
+    const auto a = lo - 4 * frac - gap, b = hi + gap;
+    sampleNinthers(r, lo, hi, frac, a, b, less,
+        std::integral_constant<bool, IsGatheredSampling<P>::value
+            && HasGatheredNinthers<It, Compare>::value>());
+
+    adaptiveQuickselect<P>(r + lo, pivot, frac, less);
+    return frac;
+}
+
+/**
+Partitions r[0 .. length] using a pivot of its own choosing. Attempts to pick a
+pivot that approximates the median. Returns the position of the pivot.
+*/
+template <class P, class It, class Compare>
+size_t medianOfNinthers(const It r, const size_t length, Compare less)
+{
+    const auto frac = ninthersSample<P>(r, length, less);
+    const auto lo = length / 2 - frac / 2;
+    return P::expandPartition(r, lo, lo + frac / 2, lo + frac, length, less);
+}
+
+/**
+Input assumptions: r[0 .. length] is partitioned around r[pivot], and n !=
+pivot.
+
+Gathers the keys equivalent to r[pivot] on the side of n next to it, with one
+comparison per key on that side, and returns the bounds of all keys known to
+be equivalent to r[pivot], the pivot included. Keys equivalent to the pivot
+on the other side stay where they are.
+*/
+template <class It, class Compare>
+std::pair<size_t, size_t> gatherEquivalent(It r, size_t pivot, size_t n,
+    size_t length, Compare less)
+{
+    assert(pivot < length && n < length && n != pivot);
+    if (n < pivot)
+    {
+        // r[0 .. pivot] are no greater than the pivot
+        size_t first = pivot;
+        for (size_t i = pivot; i-- > 0; )
+        {
+            if (CNT less(r[i], r[pivot])) continue;
+            if (--first != i) cswap(r[i], r[first]);
+        }
+        return { first, pivot + 1 };
+    }
+    // r[pivot + 1 .. length] are no smaller than the pivot
+    size_t last = pivot + 1;
+    for (size_t i = pivot + 1; i < length; ++i)
     {
-        ninther(r, a, i - frac, b, a + 1, i, b + 1, a + 2, i + frac, b + 2);
+        if (CNT less(r[pivot], r[i])) continue;
+        if (last != i) cswap(r[i], r[last]);
+        ++last;
     }
+    return { pivot, last };
+}
+
+/**
+Same as medianOfNinthers, but returns the bounds of the keys known to be
+equivalent to the pivot. If another ninther in the sample is equivalent to
+the pivot, which suggests that many keys are, and the pivot doesn't land at
+n, the keys equivalent to the pivot on the side of n are then gathered next
+to it (see gatherEquivalent). That costs about as much as the next
+partitioning step, and ends selection if n falls among them. Otherwise the
+bounds are those of the pivot alone. Samples are only checked on arrays
+longer than the mediumLength of tuning<T>(), where that costs at most one
+comparison per mediumFraction elements.
+*/
+template <class P, class It, class Compare>
+std::pair<size_t, size_t> medianOfNinthersRange(const It r, const size_t n,
+    const size_t length, Compare less)
+{
+    using T = typename std::iterator_traits<It>::value_type;
+    const auto frac = ninthersSample<P>(r, length, less);
+    const auto lo = length / 2 - frac / 2, pivot = lo + frac / 2,
+        hi = lo + frac;
+    // Ninthers before the pivot are no greater and those after it no
+    // smaller, so one comparison tells whether each is equivalent
+    bool duplicates = false;
+    if (length > tuning<T>().mediumLength)
+    {
+        for (size_t i = lo; i < pivot && !duplicates; ++i)
+            duplicates = !(CNT less(r[i], r[pivot]));
+        for (size_t i = pivot + 1; i < hi && !duplicates; ++i)
+            duplicates = !(CNT less(r[pivot], r[i]));
+    }
+    const auto p = P::expandPartition(r, lo, pivot, hi, length, less);
+    if (!duplicates || p == n) return { p, p + 1 };
+    return gatherEquivalent(r, p, n, length, less);
+}
 
-    adaptiveQuickselect(r + lo, pivot, frac);
-    return expandPartition(r, lo, lo + pivot, hi, length);
+/**
+Three-way partition of r[0 .. length] around lo and hi (with !less(hi, lo)):
+elements less than lo go to the left, greater than hi to the right, and the
+rest in between, whose bounds are returned. Every element is first compared
+against hi, so elements greater than hi cost one comparison and the others
+two. Call it on reversed ranges to favor the left side instead.
+*/
+template <class It, class Compare>
+std::pair<size_t, size_t> dualPivotPartition(It r, size_t length,
+    const typename std::iterator_traits<It>::value_type& lo,
+    const typename std::iterator_traits<It>::value_type& hi, Compare less)
+{
+    // r[0 .. left] < lo, r[left .. i] in the middle, r[right .. length] > hi
+    size_t left = 0, i = 0, right = length;
+    while (i < right)
+    {
+        if (CNT less(hi, r[i]))
+        {
+            // Find an element on the right that doesn't belong there
+            do --right; while (right > i && CNT less(hi, r[right]));
+            if (right == i) break;
+            cswap(r[i], r[right]);
+        }
+        if (CNT less(r[i], lo))
+        {
+            cswap(r[i], r[left]);
+            ++left;
+        }
+        ++i;
+    }
+    return { left, right };
+}
+
+/**
+Floyd-Rivest step. Gathers about length^(2/3) / 2 evenly spaced elements at the
+front of r, selects from them two elements whose ranks bracket the rank in the
+sample that corresponds to n, and partitions r[0 .. length] three ways around
+them. Elements are compared first against the pivot on the larger side of n,
+so the step takes about length + min(n, length - n) comparisons. Returns the
+bounds of the middle part, which is small and most likely contains position
+n, although this is not guaranteed: see adaptiveQuickselect for the fallback.
+If the two pivots are equivalent and the middle part contains n, r[n] is in
+place and { n, n + 1 } is returned.
+*/
+template <class P, class It, class Compare>
+std::pair<size_t, size_t> floydRivest(const It r, const size_t n,
+    const size_t length, Compare less)
+{
+    assert(length >= floydRivestMinLength);
+    const size_t sample = size_t(0.5 * std::pow(double(length), 2.0 / 3)),
+        step = length / sample,
+        gap = size_t(1.5 * std::sqrt(double(sample)));
+    for (size_t i = 1; i < sample; ++i)
+        cswap(r[i], r[i * step]);
+    const size_t target = size_t(double(n) * sample / length);
+    const size_t loRank = target - std::min(gap, target),
+        hiRank = std::min(target + gap, sample - 1);
+    adaptiveQuickselect<P>(r, hiRank, sample, less);
+    if (loRank < hiRank) adaptiveQuickselect<P>(r, loRank, hiRank, less);
+    const auto lo = r[loRank], hi = r[hiRank];
+    std::pair<size_t, size_t> middle;
+    if (n < length / 2)
+    {
+        middle = dualPivotPartition(r, length, lo, hi, less);
+    }
+    else
+    {
+        // Compare against lo first by partitioning the reversed range
+        using Reversed = std::reverse_iterator<It>;
+        middle = dualPivotPartition(Reversed(r + length), length, hi, lo,
+            [&less](const decltype(lo)& a, const decltype(lo)& b)
+            {
+                return less(b, a);
+            });
+        middle = { length - middle.second, length - middle.first };
+    }
+    if (!less(lo, hi) && n >= middle.first && n < middle.second)
+    {
+        // The middle part is all equivalent to r[n]
+        return { n, n + 1 };
+    }
+    return middle;
+}
+
+/**
+Partitions r[0 .. length] around a pivot chosen to land at or near position n,
+dispatching to medianOfNinthers, medianOfMinima, or medianOfMaxima depending on
+the relationship between n and length, with the thresholds of tuning<T>()
+for the element type T. Ranges of up to its networkLength elements are
+partitioned exactly around position n by networkSelect. Returns the position
+of the pivot.
+*/
+template <class P, class It, class Compare>
+size_t adaptivePartition(It r, size_t n, size_t length, Compare less)
+{
+    assert(n < length);
+    if (n == 0)
+    {
+        // That would be the max
+        auto pivot = n;
+        for (++n; n < length; ++n)
+            if (CNT less(r[n], r[pivot])) pivot = n;
+        cswap(r[0], r[pivot]);
+        return 0;
+    }
+    if (n + 1 == length)
+    {
+        // That would be the min
+        size_t pivot = 0;
+        for (n = 1; n < length; ++n)
+            if (CNT less(r[pivot], r[n])) pivot = n;
+        cswap(r[pivot], r[length - 1]);
+        return length - 1;
+    }
+    using T = typename std::iterator_traits<It>::value_type;
+    const auto t = tuning<T>();
+    if (length <= t.networkLength)
+    {
+        networkSelect(r, n, length, less);
+        return n;
+    }
+    if (n * t.extremeRatio <= length)
+        return medianOfMinima<P>(r, n, length, less);
+    if (n * t.extremeRatio >= length * (t.extremeRatio - 1))
+        return medianOfMaxima<P>(r, n, length, less);
+    return medianOfNinthers<P>(r, length, less);
+}
+
+/**
+Same as adaptivePartition, but uses medianOfNinthersRange where it would use
+medianOfNinthers. Returns the bounds of the keys known to be equivalent to
+the pivot, which contain position n if the pivot landed there.
+*/
+template <class P, class It, class Compare>
+std::pair<size_t, size_t> adaptivePartitionRange(It r, size_t n,
+    size_t length, Compare less)
+{
+    using T = typename std::iterator_traits<It>::value_type;
+    const auto t = tuning<T>();
+    if (length > t.networkLength && middleRank(t, n, length))
+        return medianOfNinthersRange<P>(r, n, length, less);
+    const auto pivot = adaptivePartition<P>(r, n, length, less);
+    return { pivot, pivot + 1 };
+}
+
+/**
+Whether the selection drivers narrow r[0 .. length] around n with
+floydRivestNarrow: the range must be at least samplingThreshold and
+floydRivestMinLength long, and n not close to either end.
+*/
+template <class T>
+bool usesFloydRivest(size_t n, size_t length, size_t samplingThreshold)
+{
+    return length >= std::max(samplingThreshold, floydRivestMinLength)
+        && middleRank(tuning<T>(), n, length);
+}
+
+/**
+Narrowing step of the selection drivers: partitions r[0 .. length] with
+floydRivest, stores the bounds of its middle part in middle, and returns the
+bounds [lo, hi) of the part that holds position n. If n falls outside the
+middle part, or the part left exceeds three quarters of the range, the sample
+was unrepresentative and samplingThreshold is set to SIZE_MAX, so that the
+rest of the selection falls back to the linear worst case strategies.
+*/
+template <class P, class It, class Compare>
+std::pair<size_t, size_t> floydRivestNarrow(It r, size_t n, size_t length,
+    Compare less, size_t& samplingThreshold,
+    std::pair<size_t, size_t>& middle)
+{
+    middle = floydRivest<P>(r, n, length, less);
+    size_t lo = 0, hi = length;
+    if (n < middle.first) hi = middle.first;
+    else if (n >= middle.second) lo = middle.second;
+    else lo = middle.first, hi = middle.second;
+    if (n < middle.first || n >= middle.second || (hi - lo) * 4 > length * 3)
+        samplingThreshold = SIZE_MAX;
+    return { lo, hi };
 }
 
 /**
 
 Quickselect driver for medianOfNinthers, medianOfMinima, and medianOfMaxima.
 Dispathes to each depending on the relationship between n (the sought order
-statistics) and length.
+statistics) and length. P is the partitioner (HoarePartitioner,
+BlockPartitioner, or SimdPartitioner) used for all partitioning steps. The
+order is given by less, which works like the comparator of std::nth_element.
+
+Ranges of at least samplingThreshold elements (none by default) in which
+medianOfNinthers would be used are narrowed with floydRivestNarrow instead.
+Floyd-Rivest takes fewer comparisons on random data, but more time on sorted
+and duplicate-heavy data, so it is left to callers who know their data. After
+an unrepresentative sample, the rest of the selection falls back to
+medianOfNinthers, which keeps the worst case linear.
+
+When the sample of medianOfNinthers holds keys equivalent to its pivot, the
+keys equivalent to the pivot are gathered into an equal range around it (see
+medianOfNinthersRange), and selection ends as soon as n falls in that range.
 
 */
-template <class T>
-void adaptiveQuickselect(T* r, size_t n, size_t length)
+template <class P, class It, class Compare>
+void adaptiveQuickselect(It r, size_t n, size_t length, Compare less,
+    size_t samplingThreshold)
 {
+    using T = typename std::iterator_traits<It>::value_type;
     assert(n < length);
     for (;;)
     {
-        // Decide strategy for partitioning
-        if (n == 0)
+        if (usesFloydRivest<T>(n, length, samplingThreshold))
         {
-            // That would be the max
-            auto pivot = n;
-            for (++n; n < length; ++n)
-                if (r[n] <CNT r[pivot]) pivot = n;
-            cswap(r[0], r[pivot]);
-            return;
+            std::pair<size_t, size_t> middle;
+            const auto part = floydRivestNarrow<P>(r, n, length, less,
+                samplingThreshold, middle);
+            if (part.second - part.first == 1) return;
+            r += part.first;
+            n -= part.first;
+            length = part.second - part.first;
+            continue;
         }
-        if (n + 1 == length)
+        const auto middle = adaptivePartitionRange<P>(r, n, length, less);
+
+        // See how the pivot fares
+        if (n >= middle.first && n < middle.second)
         {
-            // That would be the min
-            auto pivot = 0;
-            for (n = 1; n < length; ++n)
-                if (r[pivot] <CNT r[n]) pivot = n;
-            cswap(r[pivot], r[length - 1]);
             return;
         }
-        assert(n < length);
-        size_t pivot;
-        if (length <= 16)
-            pivot = pivotPartition(r, n, length) - r;
-        else if (n * 6 <= length)
-            pivot = medianOfMinima(r, n, length);
-        else if (n * 6 >= length * 5)
-            pivot = medianOfMaxima(r, n, length);
+        if (middle.first > n)
+        {
+            length = middle.first;
+        }
         else
-            pivot = medianOfNinthers(r, length);
+        {
+            r += middle.second;
+            length -= middle.second;
+            n -= middle.second;
+        }
+    }
+}
 
-        // See how the pivot fares
-        if (pivot == n)
+/**
+Same as adaptiveQuickselect, but arrays of arithmetic keys compared by
+operator< and at least threshold long are first narrowed by radixNarrow, which
+needs no comparisons, and adaptiveQuickselect finishes the remaining range.
+Radix selection is fastest on random and duplicate-heavy data but slower than
+the median of ninthers on organpipe and m3killer, so callers opt into it.
+*/
+template <class P = HoarePartitioner, class It, class Compare = std::less<>>
+void radixSelect(It r, size_t n, size_t length, Compare less = Compare(),
+    size_t threshold = radixSelectThreshold)
+{
+    assert(n < length);
+    if (UsesRadixSelect<It, Compare>::value && length >= threshold)
+    {
+        const auto middle = radixNarrow(r, n, length, less,
+            UsesRadixSelect<It, Compare>());
+        if (middle.second - middle.first == 1) return;
+        r += middle.first;
+        n -= middle.first;
+        length = middle.second - middle.first;
+    }
+    adaptiveQuickselect<P>(r, n, length, less);
+}
+
+/**
+Approximate selection: partitions like adaptiveQuickselect, but stops as soon
+as some element is in its sorted place at a position p no farther than
+tolerance * length from n, and returns p. Then r[p] is the element of rank p,
+with no greater elements before it and no smaller ones after it. With
+tolerance 0, p is n. Arrays are not narrowed by radixNarrow, which places no
+element until its last digit.
+
+If useBounds is set, selection also stops once the ranks that earlier steps
+imply for a group of elements are all tolerated: when the remaining range, or
+the middle part of a floydRivest step (which lies between the two pivots
+drawn from its sample), starts or ends within tolerance, its minimum or
+maximum is moved to that end with one scan and its position returned.
+*/
+template <class P = HoarePartitioner, class It, class Compare = std::less<>>
+size_t approximateQuickselect(It r, size_t n, size_t length, double tolerance,
+    Compare less = Compare(), bool useBounds = true)
+{
+    assert(n < length && tolerance >= 0);
+    using T = typename std::iterator_traits<It>::value_type;
+    // Tolerances beyond 1 allow any rank; clamp to keep the product in range
+    const auto slack = size_t(std::min(tolerance, 1.0) * length);
+    // Tolerated positions are lo to hi, relative to r - base
+    const size_t lo = n - std::min(n, slack),
+        hi = std::min(n + slack, length - 1);
+    size_t base = 0, samplingThreshold = floydRivestThreshold;
+    // Moves the min or the max of r[first .. last] to its end closer to n,
+    // which must be tolerated, and returns its position
+    auto placeEnd = [&](size_t first, size_t last)
+    {
+        const size_t front = n > first ? n - first : first - n,
+            back = n > last - 1 ? n - (last - 1) : last - 1 - n;
+        return base + first + adaptivePartition<P>(r + first,
+            front <= back ? 0 : last - first - 1, last - first, less);
+    };
+    for (;;)
+    {
+        if (useBounds && (base >= lo || base + length - 1 <= hi))
+            return placeEnd(0, length);
+        if (usesFloydRivest<T>(n, length, samplingThreshold))
         {
-            return;
+            std::pair<size_t, size_t> middle;
+            const auto part = floydRivestNarrow<P>(r, n, length, less,
+                samplingThreshold, middle);
+            if (part.second - part.first == 1) return base + n;
+            if (useBounds)
+            {
+                const auto first = base + middle.first,
+                    last = base + middle.second - 1;
+                if ((first >= lo && first <= hi) || (last >= lo && last <= hi))
+                    return placeEnd(middle.first, middle.second);
+            }
+            r += part.first;
+            n -= part.first;
+            base += part.first;
+            length = part.second - part.first;
+            continue;
         }
+        auto pivot = adaptivePartition<P>(r, n, length, less);
+        if (base + pivot >= lo && base + pivot <= hi) return base + pivot;
         if (pivot > n)
         {
             length = pivot;
@@ -152,8 +605,148 @@ void adaptiveQuickselect(T* r, size_t n, size_t length)
         {
             ++pivot;
             r += pivot;
+            base += pivot;
             length -= pivot;
             n -= pivot;
         }
     }
 }
+
+template <class P, class It, class Compare>
+void multiselectImpl(It r, size_t length, const size_t* ks, size_t count,
+    size_t base, Compare less)
+{
+    // Ranks in ks are relative to r - base, i.e. to the beginning of the
+    // range originally passed to multiselect.
+    while (count > 0)
+    {
+        assert(base <= ks[0] && ks[count - 1] - base < length);
+        if (count == 1)
+            return adaptiveQuickselect<P>(r, ks[0] - base, length, less);
+        const auto pivot = base
+            + adaptivePartition<P>(r, ks[count / 2] - base, length, less);
+        const auto lo = std::lower_bound(ks, ks + count, pivot),
+            hi = std::upper_bound(lo, ks + count, pivot);
+        const auto lCount = size_t(lo - ks), rCount = size_t(ks + count - hi);
+        const auto rOffset = pivot + 1 - base;
+        // Recurse into the side with fewer ranks, iterate on the other
+        if (lCount < rCount)
+        {
+            multiselectImpl<P>(r, pivot - base, ks, lCount, base, less);
+            r += rOffset;
+            length -= rOffset;
+            base = pivot + 1;
+            ks = hi;
+            count = rCount;
+        }
+        else
+        {
+            multiselectImpl<P>(r + rOffset, length - rOffset, hi, rCount,
+                pivot + 1, less);
+            length = pivot - base;
+            count = lCount;
+        }
+    }
+}
+
+/**
+Places several order statistics at once: for each k in ks[0 .. count], which
+must be sorted, r[k] ends up being the element that would be there if r[0 ..
+length] were sorted, with no greater elements before it and no smaller ones
+after it. Each partitioning step aims at the middle requested rank and serves
+all ranks on either side, so only segments still containing requested ranks
+get partitioned further.
+*/
+template <class P = HoarePartitioner, class It, class Compare = std::less<>>
+void multiselect(It r, size_t length, const size_t* ks, size_t count,
+    Compare less = Compare())
+{
+    assert(std::is_sorted(ks, ks + count));
+    assert(count == 0 || ks[count - 1] < length);
+    multiselectImpl<P>(r, length, ks, count, 0, less);
+}
+
+/**
+Arrays at most this long are sorted by insertion by adaptivePartialSort.
+*/
+const size_t partialSortInsertionThreshold = 16;
+
+template <class It, class Compare>
+void insertionSort(It r, size_t length, Compare less)
+{
+    for (size_t i = 1; i < length; ++i)
+    {
+        for (size_t j = i; j > 0 && CNT less(r[j], r[j - 1]); --j)
+            cswap(r[j], r[j - 1]);
+    }
+}
+
+template <class P, class It, class Compare>
+void adaptivePartialSortImpl(It r, size_t k, size_t length, Compare less)
+{
+    while (k > 0)
+    {
+        assert(k <= length);
+        if (length <= partialSortInsertionThreshold)
+            return insertionSort(r, length, less);
+        // Aim at the last sorted position while it's inside the range, so
+        // the pivots found are those of adaptiveQuickselect. Once sorting
+        // the entire range, aim at the middle instead.
+        const auto pivot = adaptivePartition<P>(r, k < length ? k - 1
+            : length / 2, length, less);
+        if (pivot >= k)
+        {
+            length = pivot;
+            continue;
+        }
+        // Everything up to the pivot is part of the result. Sort the smaller
+        // side recursively.
+        const auto right = pivot + 1;
+        if (k == length && length - right < pivot)
+        {
+            adaptivePartialSortImpl<P>(r + right, length - right,
+                length - right, less);
+            k = length = pivot;
+        }
+        else
+        {
+            adaptivePartialSortImpl<P>(r, pivot, pivot, less);
+            r += right;
+            length -= right;
+            k -= right;
+        }
+    }
+}
+
+/**
+Works like std::partial_sort: places the k smallest elements of r[0 .. length]
+in r[0 .. k] in sorted order, and leaves the others in r[k .. length] in
+unspecified order. It runs adaptiveQuickselect for rank k - 1, but each time a
+pivot lands before k, the segment to its left is final and gets sorted right
+away (by the same partitioning steps, aimed at its middle). The pivots found
+while selecting thus serve as the first level of the sort instead of being
+discarded, and no element past the k-th smallest is ever sorted.
+*/
+template <class P = HoarePartitioner, class It, class Compare = std::less<>>
+void adaptivePartialSort(It r, size_t k, size_t length,
+    Compare less = Compare())
+{
+    assert(k <= length);
+    adaptivePartialSortImpl<P>(r, k, length, less);
+}
+
+/**
+Drop-in replacement for std::nth_element, with an optional projection applied
+to elements before comparing them (as in C++20's std::ranges::nth_element).
+Accepts random-access iterators. P selects the partitioner.
+*/
+template <class P = HoarePartitioner, class It, class Compare = std::less<>,
+    class Projection = Identity>
+void adaptiveNthElement(It first, It nth, It last, Compare comp = Compare(),
+    Projection proj = Projection())
+{
+    if (first == last || nth == last) return;
+    assert(first <= nth && nth < last);
+    adaptiveQuickselect<P>(first, nth - first, last - first,
+        projectedLess(comp, proj));
+}
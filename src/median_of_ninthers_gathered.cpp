@@ -0,0 +1,48 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#include "median_of_ninthers.h"
+
+// The partitioning of median_of_ninthers, with gathered sampling
+using GatheredPartitioner = GatheredSampling<HoarePartitioner>;
+
+template <class T>
+static void quickselect(T* beg, T* mid, T* end)
+{
+    if (beg == end || mid >= end) return;
+    assert(beg <= mid && mid < end);
+    adaptiveQuickselect<GatheredPartitioner>(beg, mid - beg, end - beg);
+}
+
+void (*computeSelection)(double*, double*, double*)
+    = &quickselect<double>;
+
+template <class T>
+static void multiselect(T* beg, T* end, const size_t* ks, size_t count)
+{
+    ::multiselect<GatheredPartitioner>(beg, end - beg, ks, count);
+}
+
+void (*computeMultiselection)(double*, double*, const size_t*, size_t)
+    = &multiselect<double>;
+
+template <class T>
+static void partialSort(T* beg, T* mid, T* end)
+{
+    adaptivePartialSort<GatheredPartitioner>(beg, mid - beg, end - beg);
+}
+
+void (*computePartialSort)(double*, double*, double*) = &partialSort<double>;
+
+const char* selectionVariant()
+{
+    switch (simdLevel())
+    {
+    case SimdLevel::avx512: return "gathered-avx512";
+    case SimdLevel::avx2: return "gathered-avx2";
+    default: return "gathered-none";
+    }
+}
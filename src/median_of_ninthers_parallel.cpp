@@ -0,0 +1,40 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#include "parallel_select.h"
+#include <cstdio>
+
+// Counters are per thread, so instrumented builds run on one thread to count
+// all the work. The results don't depend on the thread count, so the counts
+// are the same. The pool is created on first use, after main has set up its
+// PerfCounters, so that hardware events of the workers are counted too.
+static ThreadPool& pool()
+{
+#if defined(COUNT_COMPARISONS) || defined(COUNT_SWAPS)
+    static ThreadPool result(1);
+#else
+    static ThreadPool result(defaultThreadCount());
+#endif
+    return result;
+}
+
+template <class T>
+static void quickselect(T* beg, T* mid, T* end)
+{
+    if (beg == end || mid >= end) return;
+    assert(beg <= mid && mid < end);
+    parallelQuickselect(pool(), beg, mid - beg, end - beg, std::less<>());
+}
+
+void (*computeSelection)(double*, double*, double*)
+    = &quickselect<double>;
+
+const char* selectionVariant()
+{
+    static char buf[32];
+    snprintf(buf, sizeof(buf), "threads=%zu", pool().size());
+    return buf;
+}
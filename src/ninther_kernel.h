@@ -0,0 +1,31 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+// No include guard: gathered_sampling.h includes this once per instruction
+// set, inside that instruction set's namespace and #pragma GCC target region.
+// The loops are kept plain so that the compiler turns each min and max into
+// one vector instruction.
+
+template <class T>
+inline T medianOf3(T a, T b, T c)
+{
+    return std::max(std::min(a, b), std::min(std::max(a, b), c));
+}
+
+/**
+Writes to out[j], for j < count, the ninther of column j of rows: the median
+of the medians of rows[0 .. 3], rows[3 .. 6], and rows[6 .. 9].
+*/
+template <class T>
+void ninthers(const T (*__restrict rows)[ninthersBlock], T* __restrict out,
+    size_t count)
+{
+    for (size_t j = 0; j < count; ++j)
+        out[j] = medianOf3(
+            medianOf3(rows[0][j], rows[1][j], rows[2][j]),
+            medianOf3(rows[3][j], rows[4][j], rows[5][j]),
+            medianOf3(rows[6][j], rows[7][j], rows[8][j]));
+}
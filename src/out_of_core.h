@@ -0,0 +1,240 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include "median_of_ninthers.h"
+#include "mapped_array.h"
+#include <cmath>
+#include <vector>
+
+/**
+The memory budget of outOfCoreSelect is never less than this many elements.
+*/
+const size_t outOfCoreMinCapacity = 4096;
+
+/**
+Range of values [lo, hi] (either end possibly open or absent) known or guessed
+to contain the sought order statistic.
+*/
+template <class T>
+struct SelectionWindow
+{
+    T lo {}, hi {};
+    bool hasLo = false, hasHi = false;
+    bool loInclusive = true, hiInclusive = true;
+
+    template <class Compare>
+    bool below(const T& x, Compare less) const
+    {
+        return hasLo && (loInclusive ? less(x, lo) : !less(lo, x));
+    }
+    template <class Compare>
+    bool above(const T& x, Compare less) const
+    {
+        return hasHi && (hiInclusive ? less(hi, x) : !less(x, hi));
+    }
+    /** Whether the window holds only values equivalent to lo. */
+    template <class Compare>
+    bool single(Compare less) const
+    {
+        return hasLo && hasHi && loInclusive && hiInclusive && !less(lo, hi);
+    }
+};
+
+/**
+Uniform subsample of a stream of elements, kept within capacity. All elements
+are kept until capacity is reached. From then on, every time the buffer fills
+up every other element in it is dropped, and only every step-th element of
+the stream is added, where step doubles each time.
+*/
+template <class T>
+struct StreamSample
+{
+    std::vector<T> items;
+    size_t capacity = 0, seen = 0, step = 1, skip = 0;
+
+    void reset(size_t newCapacity)
+    {
+        assert(newCapacity >= 2);
+        items.clear();
+        items.reserve(newCapacity);
+        capacity = newCapacity;
+        seen = skip = 0;
+        step = 1;
+    }
+
+    void add(const T& x)
+    {
+        ++seen;
+        if (++skip < step) return;
+        skip = 0;
+        if (items.size() == capacity)
+        {
+            for (size_t j = 1; j < capacity; j += 2)
+                items[j / 2] = std::move(items[j]);
+            items.resize(capacity / 2);
+            step *= 2;
+        }
+        items.push_back(x);
+    }
+
+    /** Whether items holds all elements seen. */
+    bool complete() const { return step == 1; }
+};
+
+/**
+Narrows outer to a window around the element of rank t among the total
+elements in outer, given a uniform sample of them in sample. The window is
+sized to hold about capacity / 2 elements. If the sample suggests the window
+won't exclude anything (which happens with many duplicates), the window is
+shrunk to just the value of the sample's element of rank t so that the next
+pass makes progress.
+*/
+template <class T, class Compare>
+SelectionWindow<T> narrowWindow(std::vector<T>& sample,
+    const SelectionWindow<T>& outer, size_t t, size_t total, size_t capacity,
+    Compare less)
+{
+    const size_t m = sample.size();
+    assert(m > 0 && t < total);
+    const size_t p = std::min(size_t(double(t) * m / total), m - 1);
+    const size_t delta = std::max(size_t(double(capacity) * m / (4.0 * total)),
+        size_t(sqrt(double(m))) + 1);
+    auto result = outer;
+    size_t ks[3] = { p };
+    size_t count = 1;
+    const bool narrowLo = p >= delta, narrowHi = p + delta < m;
+    if (narrowLo) ks[count++] = p - delta;
+    if (narrowHi) ks[count++] = p + delta;
+    std::sort(ks, ks + count);
+    multiselect(sample.data(), m, ks, count, less);
+    if (narrowLo)
+    {
+        result.lo = sample[p - delta];
+        result.hasLo = result.loInclusive = true;
+    }
+    if (narrowHi)
+    {
+        result.hi = sample[p + delta];
+        result.hasHi = result.hiInclusive = true;
+    }
+    const auto excluded = std::count_if(sample.begin(), sample.end(),
+        [&](const T& x) { return result.below(x, less)
+            || result.above(x, less); });
+    if (excluded == 0)
+    {
+        result.lo = result.hi = sample[p];
+        result.hasLo = result.hasHi = true;
+        result.loInclusive = result.hiInclusive = true;
+    }
+    return result;
+}
+
+/**
+Returns the element of rank k of data[0 .. length] (as if sorted by less)
+without modifying data and holding at most about budgetBytes of it in memory,
+which makes it suitable for memory-mapped files larger than RAM.
+
+If the data fits in the budget it is copied and selected in one pass.
+Otherwise, a sampling pass reads evenly spaced elements, in the spirit of how
+medianOfNinthers samples the array, and picks a window of values around the
+sample's element of rank k. Then a streaming pass counts the elements on
+either side of the window and collects those inside it. If rank k falls among
+them and they fit in the budget, adaptiveQuickselect finishes in memory;
+typically this is the only full pass. Otherwise, the pass has also kept
+uniform subsamples of the elements inside the window and on either side of
+it, from which a narrower window is computed for another pass.
+*/
+template <class T, class Compare = std::less<>>
+T outOfCoreSelect(const T* data, size_t length, size_t k, size_t budgetBytes,
+    OutOfCoreStats& stats, Compare less = Compare())
+{
+    assert(k < length);
+    const size_t capacity = std::max(budgetBytes / sizeof(T),
+        outOfCoreMinCapacity);
+
+    if (length <= capacity)
+    {
+        std::vector<T> buf(data, data + length);
+        stats.peakBytes = std::max(stats.peakBytes, length * sizeof(T));
+        ++stats.passes;
+        stats.bytesRead += length * sizeof(T);
+        adaptiveQuickselect(buf.data(), k, length, less);
+        return buf[k];
+    }
+
+    // Most of the budget goes to the candidates, the rest to subsamples of
+    // elements on either side of the window in case it misses.
+    StreamSample<T> lower, inner, upper;
+    lower.reset(capacity / 8);
+    inner.reset(capacity - 2 * (capacity / 8));
+    upper.reset(capacity / 8);
+    stats.peakBytes = std::max(stats.peakBytes, capacity * sizeof(T));
+
+    // Sampling pass
+    const size_t sampleSize = capacity / 4;
+    for (size_t i = 0; i < sampleSize; ++i)
+        inner.items.push_back(data[size_t(double(length) * i / sampleSize)]);
+    stats.bytesRead += sampleSize * sizeof(T);
+    SelectionWindow<T> outer;
+    auto window = narrowWindow(inner.items, outer, k, length, inner.capacity,
+        less);
+
+    for (;;)
+    {
+        // Streaming pass
+        lower.reset(lower.capacity);
+        inner.reset(inner.capacity);
+        upper.reset(upper.capacity);
+        size_t belowOuter = 0;
+        for (size_t i = 0; i < length; ++i)
+        {
+            const auto& x = data[i];
+            if (outer.below(x, less)) ++belowOuter;
+            else if (outer.above(x, less)) continue;
+            else if (window.below(x, less)) lower.add(x);
+            else if (window.above(x, less)) upper.add(x);
+            else inner.add(x);
+        }
+        ++stats.passes;
+        stats.bytesRead += length * sizeof(T);
+
+        // Find where rank k went, which becomes the new outer range
+        assert(k >= belowOuter);
+        auto t = k - belowOuter;
+        StreamSample<T>* region;
+        if (t < lower.seen)
+        {
+            region = &lower;
+            outer.hi = window.lo;
+            outer.hasHi = true;
+            outer.hiInclusive = false;
+        }
+        else if ((t -= lower.seen) < inner.seen)
+        {
+            region = &inner;
+            outer = window;
+        }
+        else
+        {
+            t -= inner.seen;
+            assert(t < upper.seen);
+            region = &upper;
+            outer.lo = window.hi;
+            outer.hasLo = true;
+            outer.loInclusive = false;
+        }
+        auto& items = region->items;
+        if (region->complete())
+        {
+            adaptiveQuickselect(items.data(), t, items.size(), less);
+            return items[t];
+        }
+        if (outer.single(less)) return outer.lo;
+        window = narrowWindow(items, outer, t, region->seen, inner.capacity,
+            less);
+    }
+}
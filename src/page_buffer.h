@@ -0,0 +1,173 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "thread_pool.h"
+
+/**
+Pages a PageBuffer can be backed with:
+- standard: whatever the system gives anonymous memory by default
+- small: base pages only (MADV_NOHUGEPAGE)
+- transparent: transparent huge pages (MADV_HUGEPAGE), with the buffer aligned
+  to them
+- huge: explicit huge pages (MAP_HUGETLB), which must be reserved beforehand
+  in /proc/sys/vm/nr_hugepages; without enough of them, the buffer falls back
+  to transparent huge pages
+*/
+enum class PageKind { standard, small, transparent, huge };
+const char* const pageKindNames[] = { "standard", "small", "transparent",
+    "huge" };
+
+/**
+Where the pages of a PageBuffer go on NUMA machines, by first touch:
+- local: the allocating thread touches all of them, so they are on its node
+- spread: defaultThreadCount() threads each touch one contiguous chunk, as
+  ThreadPool deals work to its participants
+*/
+enum class Placement { local, spread };
+const char* const placementNames[] = { "local", "spread" };
+
+/**
+Size of the huge pages of the transparent and huge kinds.
+*/
+const size_t hugePageSize = size_t(2) << 20;
+
+struct BufferOptions
+{
+    PageKind pages = PageKind::standard;
+    Placement placement = Placement::local;
+};
+
+/**
+Sets the option of opts given by arg, which is --pages= followed by a
+PageKind or --placement= followed by a Placement. Returns false if arg is
+neither.
+*/
+inline bool parseBufferOption(const char* arg, BufferOptions& opts)
+{
+    const auto match = [arg](const char* name, const char* const* values,
+        size_t count, size_t& result)
+    {
+        const auto n = strlen(name);
+        if (strncmp(arg, name, n) != 0) return false;
+        for (result = 0; result < count; ++result)
+            if (strcmp(arg + n, values[result]) == 0) return true;
+        return false;
+    };
+    size_t i;
+    if (match("--pages=", pageKindNames, 4, i)) opts.pages = PageKind(i);
+    else if (match("--placement=", placementNames, 2, i))
+        opts.placement = Placement(i);
+    else return false;
+    return true;
+}
+
+/**
+Buffer of length uninitialized elements of trivial type T, mapped directly
+from the kernel with the pages and placement of BufferOptions, and touched
+once so that no page faults remain. Throws std::bad_alloc if the memory can't
+be mapped.
+*/
+template <class T>
+class PageBuffer
+{
+    static_assert(std::is_trivial<T>::value, "PageBuffer needs trivial types");
+
+public:
+    explicit PageBuffer(size_t length, const BufferOptions& opts = {})
+        : length_(length), pages_(opts.pages)
+    {
+        const size_t bytes = std::max<size_t>(length * sizeof(T), 1);
+        const size_t hugeBytes = roundUp(bytes, hugePageSize);
+        const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+        if (pages_ == PageKind::huge)
+        {
+            base_ = mmap(nullptr, hugeBytes, PROT_READ | PROT_WRITE,
+                flags | MAP_HUGETLB, -1, 0);
+            if (base_ != MAP_FAILED) mapped_ = hugeBytes;
+            else pages_ = PageKind::transparent;
+        }
+        if (pages_ == PageKind::transparent)
+        {
+            // Map a huge page more than needed and trim it to alignment
+            const size_t extra = hugeBytes + hugePageSize;
+            const auto p = mmap(nullptr, extra, PROT_READ | PROT_WRITE, flags,
+                -1, 0);
+            if (p == MAP_FAILED) throw std::bad_alloc();
+            const auto begin = uintptr_t(p);
+            const auto aligned = roundUp(begin, hugePageSize);
+            if (aligned > begin) munmap(p, aligned - begin);
+            const auto end = aligned + hugeBytes;
+            if (begin + extra > end) munmap((void*) end, begin + extra - end);
+            base_ = (void*) aligned;
+            mapped_ = hugeBytes;
+            madvise(base_, mapped_, MADV_HUGEPAGE);
+        }
+        else if (pages_ != PageKind::huge)
+        {
+            base_ = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (base_ == MAP_FAILED) throw std::bad_alloc();
+            mapped_ = bytes;
+            if (pages_ == PageKind::small)
+                madvise(base_, mapped_, MADV_NOHUGEPAGE);
+        }
+        touch(opts.placement);
+    }
+
+    ~PageBuffer() { munmap(base_, mapped_); }
+
+    PageBuffer(const PageBuffer&) = delete;
+    PageBuffer& operator=(const PageBuffer&) = delete;
+
+    T* data() const { return static_cast<T*>(base_); }
+    size_t size() const { return length_; }
+
+    /** Pages in effect, which differ from those asked for on fallback. */
+    PageKind pages() const { return pages_; }
+
+private:
+    static size_t roundUp(size_t n, size_t multiple)
+    {
+        return (n + multiple - 1) / multiple * multiple;
+    }
+
+    // Writes one byte of each page, from one thread or from several
+    void touch(Placement placement)
+    {
+        const size_t page = pages_ == PageKind::standard
+            || pages_ == PageKind::small ? size_t(sysconf(_SC_PAGESIZE))
+            : hugePageSize;
+        const auto bytes = static_cast<char*>(base_);
+        const size_t pageCount = roundUp(mapped_, page) / page;
+        const auto touchPages = [=](size_t from, size_t to)
+        {
+            for (size_t i = from; i < to; ++i) bytes[i * page] = 0;
+        };
+        const size_t threads = placement == Placement::spread
+            ? std::min(defaultThreadCount(), pageCount) : 1;
+        if (threads <= 1) return touchPages(0, pageCount);
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < threads; ++i)
+            workers.emplace_back(touchPages, pageCount * i / threads,
+                pageCount * (i + 1) / threads);
+        for (auto& w : workers) w.join();
+    }
+
+    void* base_ = MAP_FAILED;
+    size_t mapped_ = 0;
+    size_t length_;
+    PageKind pages_;
+};
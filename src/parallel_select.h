@@ -0,0 +1,384 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include "median_of_ninthers.h"
+#include "thread_pool.h"
+#include <vector>
+
+/*
+Parallel counterpart of adaptiveQuickselect for arrays that exceed the
+cache. The work is cut into tasks of a fixed number of elements regardless of
+the number of threads, so the final permutation of the array depends only on
+its contents: running with 1 or 64 threads produces identical results (and
+identical comparison and swap counts, which is why the instrumented builds run
+on one thread without loss of information).
+*/
+
+/**
+Elements per task for partitioning and for scanning. Large enough to amortize
+scheduling, small enough to balance load over many threads.
+*/
+const size_t parallelChunkSize = 64 * 1024;
+
+/**
+Ranges that fit in this many bytes are handed over to the serial
+adaptiveQuickselect, which is faster once the data is in cache.
+*/
+const size_t parallelCutoffBytes = 4 * 1024 * 1024;
+
+/**
+Partitions r[0 .. length] around the value pivot, which must not be stored
+within r[0 .. length]. Returns the size of the left side, such that r[0 ..
+result] are not greater than pivot and r[result .. length] are not less. Each
+chunk of parallelChunkSize elements is first partitioned separately (in the
+manner of partitionScalar, i.e. elements equal to pivot may go either way),
+after which elements on the wrong side of the global split are exchanged in
+parallel.
+*/
+template <class It, class Compare>
+size_t parallelPartition(ThreadPool& pool, It r, size_t length,
+    const typename std::iterator_traits<It>::value_type& pivot, Compare less)
+{
+    const size_t chunks = (length + parallelChunkSize - 1) / parallelChunkSize;
+    std::vector<size_t> splits(chunks);
+    pool.parallelFor(chunks, [&](size_t c)
+    {
+        const auto beg = c * parallelChunkSize;
+        const auto end = std::min(beg + parallelChunkSize, length);
+        size_t lo = beg, hi = end;
+        for (;;)
+        {
+            while (lo < hi && CNT less(r[lo], pivot)) ++lo;
+            while (lo < hi && CNT less(pivot, r[hi - 1])) --hi;
+            if (lo >= hi) break;
+            --hi;
+            cswap(r[lo], r[hi]);
+            ++lo;
+        }
+        splits[c] = lo;
+    });
+
+    size_t split = 0;
+    for (size_t c = 0; c < chunks; ++c)
+        split += splits[c] - c * parallelChunkSize;
+
+    // Collect the runs of misplaced elements: right sides of chunks that
+    // fall below split, and left sides of chunks that fall above it. Both
+    // add up to the same count.
+    struct Run { size_t begin, end; };
+    std::vector<Run> wrongLeft, wrongRight;
+    for (size_t c = 0; c < chunks; ++c)
+    {
+        const auto beg = c * parallelChunkSize;
+        const auto end = std::min(beg + parallelChunkSize, length);
+        if (splits[c] < std::min(end, split))
+            wrongLeft.push_back({ splits[c], std::min(end, split) });
+        if (std::max(beg, split) < splits[c])
+            wrongRight.push_back({ std::max(beg, split), splits[c] });
+    }
+    // Prefix sums of run lengths
+    const auto prefix = [](const std::vector<Run>& runs)
+    {
+        std::vector<size_t> result(runs.size() + 1);
+        for (size_t i = 0; i < runs.size(); ++i)
+            result[i + 1] = result[i] + runs[i].end - runs[i].begin;
+        return result;
+    };
+    const auto leftSums = prefix(wrongLeft), rightSums = prefix(wrongRight);
+    const auto misplaced = leftSums.back();
+    assert(misplaced == rightSums.back());
+
+    // Swap the i-th misplaced element on the left with the i-th on the right
+    const auto tasks = (misplaced + parallelChunkSize - 1) / parallelChunkSize;
+    pool.parallelFor(tasks, [&](size_t t)
+    {
+        auto i = t * parallelChunkSize;
+        const auto last = std::min(i + parallelChunkSize, misplaced);
+        auto li = std::upper_bound(leftSums.begin(), leftSums.end(), i)
+            - leftSums.begin() - 1;
+        auto ri = std::upper_bound(rightSums.begin(), rightSums.end(), i)
+            - rightSums.begin() - 1;
+        auto lp = wrongLeft[li].begin + (i - leftSums[li]);
+        auto rp = wrongRight[ri].begin + (i - rightSums[ri]);
+        for (; i < last; ++i)
+        {
+            if (lp == wrongLeft[li].end) lp = wrongLeft[++li].begin;
+            if (rp == wrongRight[ri].end) rp = wrongRight[++ri].begin;
+            cswap(r[lp++], r[rp++]);
+        }
+    });
+    return split;
+}
+
+/**
+Swaps r[a .. a + n] with r[b .. b + n], which must not overlap.
+*/
+template <class It>
+void parallelSwapRanges(ThreadPool& pool, It r, size_t a, size_t b, size_t n)
+{
+    const auto tasks = (n + parallelChunkSize - 1) / parallelChunkSize;
+    pool.parallelFor(tasks, [&](size_t t)
+    {
+        const auto beg = t * parallelChunkSize;
+        const auto end = std::min(beg + parallelChunkSize, n);
+        for (auto i = beg; i < end; ++i)
+            cswap(r[a + i], r[b + i]);
+    });
+}
+
+/**
+Same as expandPartition, but parallel. Mirrors expandPartitionSimd: each side
+of the partitioned band r[lo .. hi] that needs work is partitioned, misplaced
+elements are swapped across in pairs, and the rest of them are swapped over
+past the pivot.
+*/
+template <class It, class Compare>
+size_t parallelExpandPartition(ThreadPool& pool, It r, size_t lo,
+    size_t pivot, size_t hi, size_t length, Compare less)
+{
+    assert(lo <= pivot && pivot < hi && hi <= length);
+    // The pivot is in neither side, so it stays put while they're partitioned
+    const size_t right = lo > 0
+        ? lo - parallelPartition(pool, r, lo, r[pivot], less) : 0;
+    const size_t left = hi < length
+        ? parallelPartition(pool, r + hi, length - hi, r[pivot], less) : 0;
+    const auto across = std::min(left, right);
+    parallelSwapRanges(pool, r, lo - right, hi + left - across, across);
+    if (left > across)
+    {
+        // Swap the rest of r[hi .. length]'s left side over to the left of
+        // the pivot.
+        const auto rest = left - across;
+        const auto m = std::min(hi - pivot - 1, rest);
+        parallelSwapRanges(pool, r, pivot + 1, hi + rest - m, m);
+        cswap(r[pivot], r[pivot + rest]);
+        return pivot + rest;
+    }
+    // Swap the rest of r[0 .. lo]'s right side over to the right of the
+    // pivot.
+    const auto rest = right - across;
+    const auto m = std::min(rest, pivot - lo);
+    parallelSwapRanges(pool, r, lo - rest, pivot - m, m);
+    cswap(r[pivot], r[pivot - rest]);
+    return pivot - rest;
+}
+
+/**
+Position of the least (if wantMax is false) or greatest element of r[0 ..
+length], scanning chunks in parallel. Ties go to the leftmost candidate.
+*/
+template <bool wantMax, class It, class Compare>
+size_t parallelMinMaxIndex(ThreadPool& pool, It r, size_t length,
+    Compare less)
+{
+    const size_t chunks = (length + parallelChunkSize - 1) / parallelChunkSize;
+    std::vector<size_t> best(chunks);
+    const auto better = [&](size_t a, size_t b)
+    {
+        return wantMax ? CNT less(r[b], r[a]) : CNT less(r[a], r[b]);
+    };
+    pool.parallelFor(chunks, [&](size_t c)
+    {
+        const auto beg = c * parallelChunkSize;
+        const auto end = std::min(beg + parallelChunkSize, length);
+        auto result = beg;
+        for (auto i = beg + 1; i < end; ++i)
+            if (better(i, result)) result = i;
+        best[c] = result;
+    });
+    auto result = best[0];
+    for (size_t c = 1; c < chunks; ++c)
+        if (better(best[c], result)) result = best[c];
+    return result;
+}
+
+template <class It, class Compare>
+void parallelQuickselect(ThreadPool& pool, It r, size_t n, size_t length,
+    Compare less);
+
+/**
+Parallel medianOfMinima: the minima are computed in parallel, after which the
+sample is selected and the partition expanded by the parallel routines.
+*/
+template <class It, class Compare>
+size_t parallelMedianOfMinima(ThreadPool& pool, const It r, const size_t n,
+    const size_t length, Compare less)
+{
+    assert(length >= 2);
+    assert(n * 4 <= length);
+    assert(n > 0);
+    const size_t subset = n * 2,
+        computeMinOver = (length - subset) / subset;
+    assert(computeMinOver > 0);
+    const size_t perTask = std::max<size_t>(1,
+        parallelChunkSize / computeMinOver);
+    pool.parallelFor((subset + perTask - 1) / perTask, [&](size_t t)
+    {
+        const auto iEnd = std::min(subset, (t + 1) * perTask);
+        for (size_t i = t * perTask, j = subset + i * computeMinOver;
+            i < iEnd; ++i)
+        {
+            const auto limit = j + computeMinOver;
+            size_t minIndex = j;
+            while (++j < limit)
+                if (CNT less(r[j], r[minIndex]))
+                    minIndex = j;
+            if (CNT less(r[minIndex], r[i]))
+                cswap(r[i], r[minIndex]);
+        }
+    });
+    parallelQuickselect(pool, r, n, subset, less);
+    return parallelExpandPartition(pool, r, 0, n, subset, length, less);
+}
+
+/**
+Parallel medianOfMaxima.
+*/
+template <class It, class Compare>
+size_t parallelMedianOfMaxima(ThreadPool& pool, const It r, const size_t n,
+    const size_t length, Compare less)
+{
+    assert(length >= 2);
+    assert(n * 4 >= length * 3 && n < length);
+    const size_t subset = (length - n) * 2,
+        subsetStart = length - subset,
+        computeMaxOver = subsetStart / subset;
+    assert(computeMaxOver > 0);
+    const size_t perTask = std::max<size_t>(1,
+        parallelChunkSize / computeMaxOver);
+    const auto jStart = subsetStart - subset * computeMaxOver;
+    pool.parallelFor((subset + perTask - 1) / perTask, [&](size_t t)
+    {
+        const auto iEnd = std::min(subset, (t + 1) * perTask);
+        for (size_t i = t * perTask, j = jStart + i * computeMaxOver;
+            i < iEnd; ++i)
+        {
+            const auto limit = j + computeMaxOver;
+            size_t maxIndex = j;
+            while (++j < limit)
+                if (CNT less(r[maxIndex], r[j]))
+                    maxIndex = j;
+            if (CNT less(r[subsetStart + i], r[maxIndex]))
+                cswap(r[subsetStart + i], r[maxIndex]);
+        }
+    });
+    parallelQuickselect(pool, r + subsetStart, length - n, subset, less);
+    return parallelExpandPartition(pool, r, subsetStart, n, length, length,
+        less);
+}
+
+/**
+Parallel medianOfNinthers: the ninthers are computed in parallel (each one
+touches its own nine elements) unless their positions overlap, after which the
+sample is selected and the partition expanded by the parallel routines.
+*/
+template <class It, class Compare>
+size_t parallelMedianOfNinthers(ThreadPool& pool, const It r,
+    const size_t length, Compare less)
+{
+    assert(length >= 12);
+    using T = typename std::iterator_traits<It>::value_type;
+    const auto frac = ninthersFraction(tuning<T>(), length);
+    auto pivot = frac / 2;
+    const auto lo = length / 2 - pivot, hi = lo + frac;
+    assert(lo >= frac * 4);
+    assert(length - hi >= frac * 4);
+    assert(lo / 2 >= pivot);
+    const auto gap = (length - 9 * frac) / 4;
+    const auto a0 = lo - 4 * frac - gap, b0 = hi + gap;
+    // With fractions over length / 13, the positions of later ninthers
+    // overlap those of earlier ones, so they must go in order on one thread
+    if (b0 < hi + frac)
+    {
+        sampleNinthers(r, lo, hi, frac, a0, b0, less, std::false_type());
+    }
+    else
+    {
+        const size_t perTask = parallelChunkSize / 9;
+        pool.parallelFor((frac + perTask - 1) / perTask, [&](size_t t)
+        {
+            const auto iEnd = std::min(hi, lo + (t + 1) * perTask);
+            auto i = lo + t * perTask;
+            for (auto a = a0 + 3 * (i - lo), b = b0 + 3 * (i - lo); i < iEnd;
+                ++i, a += 3, b += 3)
+            {
+                ninther(r, a, i - frac, b, a + 1, i, b + 1, a + 2, i + frac,
+                    b + 2, less);
+            }
+        });
+    }
+
+    parallelQuickselect(pool, r + lo, pivot, frac, less);
+    return parallelExpandPartition(pool, r, lo, lo + pivot, hi, length, less);
+}
+
+/**
+Same as adaptiveQuickselect, but runs the sampling and partitioning steps on
+pool as long as the active range doesn't fit in parallelCutoffBytes.
+*/
+template <class It, class Compare>
+void parallelQuickselect(ThreadPool& pool, It r, size_t n, size_t length,
+    Compare less)
+{
+    assert(n < length);
+    using T = typename std::iterator_traits<It>::value_type;
+    for (;;)
+    {
+        if (length * sizeof(T) <= parallelCutoffBytes)
+            return adaptiveQuickselect(r, n, length, less);
+        size_t pivot;
+        if (n == 0)
+        {
+            cswap(r[0], r[parallelMinMaxIndex<false>(pool, r, length, less)]);
+            return;
+        }
+        if (n + 1 == length)
+        {
+            cswap(r[parallelMinMaxIndex<true>(pool, r, length, less)],
+                r[length - 1]);
+            return;
+        }
+        const auto ratio = tuning<T>().extremeRatio;
+        if (n * ratio <= length)
+            pivot = parallelMedianOfMinima(pool, r, n, length, less);
+        else if (n * ratio >= length * (ratio - 1))
+            pivot = parallelMedianOfMaxima(pool, r, n, length, less);
+        else
+            pivot = parallelMedianOfNinthers(pool, r, length, less);
+
+        // See how the pivot fares
+        if (pivot == n)
+        {
+            return;
+        }
+        if (pivot > n)
+        {
+            length = pivot;
+        }
+        else
+        {
+            ++pivot;
+            r += pivot;
+            length -= pivot;
+            n -= pivot;
+        }
+    }
+}
+
+/**
+Drop-in replacement for std::nth_element running on pool. See
+adaptiveNthElement.
+*/
+template <class It, class Compare = std::less<>, class Projection = Identity>
+void parallelNthElement(ThreadPool& pool, It first, It nth, It last,
+    Compare comp = Compare(), Projection proj = Projection())
+{
+    if (first == last || nth == last) return;
+    assert(first <= nth && nth < last);
+    parallelQuickselect(pool, first, nth - first, last - first,
+        projectedLess(comp, proj));
+}
@@ -0,0 +1,148 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+Hardware events counted by PerfCounters, with the names under which they are
+reported.
+*/
+const size_t perfEventCount = 6;
+const char* const perfEventNames[perfEventCount] =
+{
+    "instructions", "cycles", "branch_misses", "l1d_misses", "llc_misses",
+    "dtlb_misses"
+};
+
+/**
+Counts hardware events (user space only) with perf_event_open while started,
+accumulating over any number of start/stop pairs. Counts cover the thread that
+constructs the object and the threads it creates afterwards, but not threads
+that already exist, such as those of a ThreadPool constructed before. Each
+event is opened on its own, so that events the processor, kernel, or virtual
+machine doesn't support, or that perf_event_paranoid forbids, are just
+unavailable and the others still count. If the kernel multiplexes counters,
+counts are scaled to the time each was enabled. Setting the environment
+variable PERF_COUNTERS to "none" disables all of them.
+*/
+class PerfCounters
+{
+public:
+    PerfCounters()
+    {
+        for (auto& fd : fds_) fd = -1;
+        const char* s = getenv("PERF_COUNTERS");
+        if (s && strcmp(s, "none") == 0) return;
+        const auto cache = [](uint64_t id, uint64_t result)
+        {
+            return id | PERF_COUNT_HW_CACHE_OP_READ << 8 | result << 16;
+        };
+        const struct { uint32_t type; uint64_t config; } events[] =
+        {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+            { PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_L1D,
+                PERF_COUNT_HW_CACHE_RESULT_MISS) },
+            { PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_LL,
+                PERF_COUNT_HW_CACHE_RESULT_MISS) },
+            { PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_DTLB,
+                PERF_COUNT_HW_CACHE_RESULT_MISS) },
+        };
+        static_assert(sizeof(events) / sizeof(*events) == perfEventCount,
+            "one event per name");
+        for (size_t i = 0; i < perfEventCount; ++i)
+        {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[i].type;
+            attr.config = events[i].config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.inherit = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+                | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds_[i] = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+    }
+
+    ~PerfCounters()
+    {
+        for (auto fd : fds_)
+            if (fd >= 0) close(fd);
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    /** Whether event i (indexing perfEventNames) is being counted. */
+    bool available(size_t i) const { return fds_[i] >= 0; }
+
+    bool anyAvailable() const
+    {
+        for (size_t i = 0; i < perfEventCount; ++i)
+            if (available(i)) return true;
+        return false;
+    }
+
+    void start()
+    {
+        for (size_t i = 0; i < perfEventCount; ++i)
+        {
+            if (!available(i) || !read(i, begin_[i])) continue;
+            ioctl(fds_[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    void stop()
+    {
+        for (size_t i = 0; i < perfEventCount; ++i)
+        {
+            if (!available(i)) continue;
+            ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+            Reading end;
+            if (!read(i, end)) continue;
+            const double running = double(end.running - begin_[i].running);
+            if (running > 0)
+                totals_[i] += double(end.value - begin_[i].value)
+                    * double(end.enabled - begin_[i].enabled) / running;
+        }
+    }
+
+    /** Count of event i over all start/stop pairs so far. */
+    double total(size_t i) const { return totals_[i]; }
+
+private:
+    // Layout given by read_format
+    struct Reading
+    {
+        uint64_t value = 0, enabled = 0, running = 0;
+    };
+
+    // Reads event i, or if that fails stops counting it, so that it's
+    // reported as unavailable
+    bool read(size_t i, Reading& r)
+    {
+        if (::read(fds_[i], &r, sizeof(r)) == ssize_t(sizeof(r))) return true;
+        close(fds_[i]);
+        fds_[i] = -1;
+        return false;
+    }
+
+    int fds_[perfEventCount];
+    Reading begin_[perfEventCount];
+    double totals_[perfEventCount] = {};
+};
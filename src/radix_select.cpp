@@ -0,0 +1,19 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#include "median_of_ninthers.h"
+
+template <class T>
+static void quickselect(T* beg, T* mid, T* end)
+{
+    if (beg == end || mid >= end) return;
+    assert(beg <= mid && mid < end);
+    // Use radix selection on all arrays, not only on long ones
+    radixSelect(beg, mid - beg, end - beg, std::less<>(), 0);
+}
+
+void (*computeSelection)(double*, double*, double*)
+    = &quickselect<double>;
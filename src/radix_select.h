@@ -0,0 +1,236 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include "common.h"
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+Order-preserving map from keys to unsigned integers of the same size (Bits):
+a < b implies get(a) < get(b), and keys that compare equal map to the same
+bits, except -0.0 and 0.0, which map to consecutive values. NaNs are not
+supported, just as they aren't by operator<.
+*/
+template <class T, class Enable = void>
+struct RadixKey
+{
+    static constexpr bool enabled = false;
+};
+
+template <class T>
+struct RadixKey<T, typename std::enable_if<std::is_integral<T>::value
+    && !std::is_same<T, bool>::value>::type>
+{
+    static constexpr bool enabled = true;
+    using Bits = typename std::make_unsigned<T>::type;
+    static Bits get(T x)
+    {
+        // Flipping the sign bit orders negative numbers first
+        const Bits sign = std::is_signed<T>::value
+            ? Bits(Bits(1) << (8 * sizeof(T) - 1)) : 0;
+        return Bits(x) ^ sign;
+    }
+};
+
+template <class T>
+struct RadixKey<T, typename std::enable_if<std::is_floating_point<T>::value
+    && (sizeof(T) == 4 || sizeof(T) == 8)>::type>
+{
+    static constexpr bool enabled = true;
+    using Bits = typename std::conditional<sizeof(T) == 4, uint32_t,
+        uint64_t>::type;
+    static Bits get(T x)
+    {
+        Bits b;
+        memcpy(&b, &x, sizeof(b));
+        // Negative numbers: flip all bits to reverse their order. Others: set
+        // the sign bit to place them after the negative ones.
+        const unsigned bits = 8 * sizeof(T);
+        const Bits flip = Bits(-Bits(b >> (bits - 1))) | Bits(1) << (bits - 1);
+        return b ^ flip;
+    }
+};
+
+/**
+Whether selection through iterator It with comparator Compare can use radix
+selection: It must be a pointer to an arithmetic type, compared by operator<.
+*/
+template <class It, class Compare>
+struct UsesRadixSelect : std::false_type {};
+template <class T>
+struct UsesRadixSelect<T*, std::less<>>
+    : std::integral_constant<bool, RadixKey<T>::enabled> {};
+template <class T>
+struct UsesRadixSelect<T*, std::less<T>>
+    : std::integral_constant<bool, RadixKey<T>::enabled> {};
+
+/**
+radixSelect narrows arrays with radix keys with radixNarrow if they are at
+least this long, unless given another threshold.
+*/
+const size_t radixSelectThreshold = 64 * 1024;
+
+/**
+radixNarrow stops narrowing once fewer elements than this are left.
+*/
+const size_t radixSelectCutoff = 1024;
+
+/**
+Digit width in bits of each radixNarrow pass.
+*/
+const unsigned radixDigitBits = 10;
+
+template <class It, class Compare>
+std::pair<size_t, size_t> radixNarrow(It, size_t, size_t length, Compare,
+    std::false_type, size_t = radixSelectCutoff)
+{
+    return { 0, length };
+}
+
+/**
+Moves the elements of r[lo .. hi] with keys less than bound to the front and
+returns their end. Branch-free, in the manner of Lomuto's partition.
+*/
+template <class T>
+size_t radixPartition(T* r, size_t lo, size_t hi,
+    typename RadixKey<T>::Bits bound)
+{
+    size_t j = lo;
+    for (size_t i = lo; i < hi; ++i)
+    {
+        const auto x = r[i];
+        const bool less = RadixKey<T>::get(x) < bound;
+        r[i] = r[j];
+        r[j] = x;
+        j += less;
+    }
+    return j;
+}
+
+/**
+MSD radix selection, which uses no comparisons. Each pass builds a histogram
+of one radixDigitBits wide digit of the keys in the current range to find
+the bucket holding rank n, then moves the elements of lower and higher
+buckets to either side with two branch-free partitioning passes. The bucket
+holding n forms the next range.
+
+The histogram is spread over four interleaved copies so runs of equal digits,
+frequent in inputs with many duplicates, don't serialize on the same counter.
+A first pass finds the bits common to all keys, and each histogram pass also
+tracks those of the keys in its range, so leading digits on which all keys
+agree are skipped and a range of equal keys ends the selection at once. The
+first pass also counts descents, and leaves inputs sorted or reverse sorted
+for the most part untouched, returning { 0, length }.
+
+Returns the bounds of the range holding n once it has fewer than cutoff
+elements, everything before it being no greater and everything after it no
+smaller. If the range is all equal, r[n] is in place and { n, n + 1 } is
+returned. Each element read by a histogram pass is accounted for as one
+comparison.
+*/
+template <class T, class Compare>
+std::pair<size_t, size_t> radixNarrow(T* r, size_t n, size_t length,
+    Compare, std::true_type, size_t cutoff = radixSelectCutoff)
+{
+    assert(n < length);
+    using Bits = typename RadixKey<T>::Bits;
+    const auto key = &RadixKey<T>::get;
+    const size_t buckets = size_t(1) << radixDigitBits;
+    const Bits mask = Bits(buckets - 1);
+    size_t lo = 0, hi = length;
+    // Bits below shift are yet to be examined. Start at the highest bit on
+    // which keys differ, otherwise floating point keys, whose exponents vary
+    // little, would mostly land in one bucket.
+    unsigned shift = 8 * sizeof(Bits);
+    if (length >= cutoff)
+    {
+        Bits allAnd = Bits(~Bits(0)), allOr = 0, previous = key(r[0]);
+        size_t descents = 0;
+        for (size_t i = 0; i < length; ++i)
+        {
+            const Bits k = key(r[i]);
+            allAnd &= k;
+            allOr |= k;
+            descents += k < previous;
+            previous = k;
+        }
+        const Bits differ = allAnd ^ allOr;
+        if (differ == 0) return { n, n + 1 };
+        // Leave presorted inputs to comparison-based selection, which does
+        // much better on them
+        if (descents < length / 16 || descents > length - length / 16)
+            return { 0, length };
+        shift = 0;
+        while (shift < 8 * sizeof(Bits) && (differ >> shift) != 0) ++shift;
+    }
+    assert(length / 4 < UINT32_MAX);
+    uint32_t counts[4][buckets];
+    while (hi - lo >= cutoff)
+    {
+        const unsigned width = std::min(shift, radixDigitBits);
+        shift -= width;
+        memset(counts, 0, sizeof(counts));
+        Bits allAnd = Bits(~Bits(0)), allOr = 0;
+        size_t i = lo;
+        for (; i + 4 <= hi; i += 4)
+        {
+            const Bits k0 = key(r[i]), k1 = key(r[i + 1]),
+                k2 = key(r[i + 2]), k3 = key(r[i + 3]);
+            ++counts[0][(k0 >> shift) & mask];
+            ++counts[1][(k1 >> shift) & mask];
+            ++counts[2][(k2 >> shift) & mask];
+            ++counts[3][(k3 >> shift) & mask];
+            allAnd &= k0 & k1 & k2 & k3;
+            allOr |= k0 | k1 | k2 | k3;
+        }
+        for (; i < hi; ++i)
+        {
+            const Bits k0 = key(r[i]);
+            ++counts[0][(k0 >> shift) & mask];
+            allAnd &= k0;
+            allOr |= k0;
+        }
+#ifdef COUNT_COMPARISONS
+        g_comparisons += hi - lo;
+#endif
+        const Bits differ = allAnd ^ allOr;
+        if (differ == 0) return { n, n + 1 };
+        if ((differ >> shift) == 0)
+        {
+            // All keys agree on this digit: go on from the highest bit on
+            // which they differ
+            shift = 0;
+            while (shift < 8 * sizeof(Bits) && (differ >> shift) != 0)
+                ++shift;
+            continue;
+        }
+
+        // Find the bucket of rank n
+        size_t below = 0, bucket = 0, inBucket;
+        for (;; ++bucket)
+        {
+            inBucket = counts[0][bucket] + counts[1][bucket]
+                + counts[2][bucket] + counts[3][bucket];
+            if (n - lo < below + inBucket) break;
+            below += inBucket;
+        }
+
+        // Move the elements of lower and higher buckets out of the way
+        const Bits first = Bits((allAnd >> shift >> radixDigitBits
+            << radixDigitBits | bucket) << shift);
+        const Bits last = Bits(first + ((Bits(1) << shift) - 1));
+        // Split off the larger side first so the second pass is shorter
+        const bool lowerFirst = below >= hi - lo - below - inBucket;
+        if (lowerFirst && below > 0) lo = radixPartition(r, lo, hi, first);
+        if (last != Bits(~Bits(0))) hi = radixPartition(r, lo, hi, last + 1);
+        if (!lowerFirst && below > 0) lo = radixPartition(r, lo, hi, first);
+        assert(hi - lo == inBucket);
+        if (shift == 0) return { n, n + 1 };
+    }
+    return { lo, hi };
+}
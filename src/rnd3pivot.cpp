@@ -12,7 +12,8 @@ static T* partition(T* r, T* end)
 {
     const size_t len = end - r;
     assert(len >= 3);
-    static std::mt19937 gen(1);
+    // One generator per thread, so concurrent calls don't race on it
+    static thread_local std::mt19937 gen(1);
     std::uniform_int_distribution<> dis(0, len - 1);
     size_t x = dis(gen), y = dis(gen), z = dis(gen);
     return pivotPartition(r, medianIndex(r, x, y, z), len);
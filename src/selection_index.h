@@ -0,0 +1,91 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include "median_of_ninthers.h"
+#include <vector>
+
+/**
+Answers rank queries on one buffer one after another, keeping the partition
+structure that earlier queries built. Every partitioning step of a query
+splits the buffer at cuts: positions c such that no element before c is
+greater than one from c on. The index keeps all cuts found so far (each range
+[p, q) of keys equivalent to a pivot contributes p and q), and each query
+selects only within the segment between the two cuts around its rank, which
+shrinks as queries accumulate. A rank that is already placed costs a binary
+search, and the total work of many queries tends to that of one partial sort
+around their ranks rather than growing with one full selection per query.
+
+The index permutes the buffer it wraps, which must stay alive and must not be
+modified otherwise while the index is in use. The values of the pivots are
+those left at the cut positions of the buffer.
+*/
+template <class T, class Compare = std::less<>, class P = HoarePartitioner>
+class SelectionIndex
+{
+public:
+    SelectionIndex(T* data, size_t length, Compare less = Compare())
+        : data_(data), length_(length), less_(less), cuts_{ 0, length }
+    {
+    }
+
+    size_t size() const { return length_; }
+
+    /** Number of cuts known, including those at 0 and size(). */
+    size_t cuts() const { return cuts_.size(); }
+
+    /**
+    Returns the element of rank k, as if the buffer were sorted, after placing
+    it at position k.
+    */
+    const T& select(size_t k)
+    {
+        assert(k < length_);
+        // Segment [lo, hi) between the nearest cuts around k
+        const auto i = std::upper_bound(cuts_.begin(), cuts_.end(), k);
+        size_t lo = i[-1], hi = *i;
+        if (hi - lo == 1) return data_[k];
+        // Same steps as adaptiveQuickselect, recording the cuts of each
+        auto samplingThreshold = floydRivestThreshold;
+        while (hi - lo > 1)
+        {
+            const auto r = data_ + lo;
+            const size_t n = k - lo, length = hi - lo;
+            if (usesFloydRivest<T>(n, length, samplingThreshold))
+            {
+                std::pair<size_t, size_t> middle;
+                const auto part = floydRivestNarrow<P>(r, n, length, less_,
+                    samplingThreshold, middle);
+                addCuts(lo + middle.first, lo + middle.second);
+                hi = lo + part.second;
+                lo += part.first;
+                continue;
+            }
+            const auto middle = adaptivePartitionRange<P>(r, n, length, less_);
+            addCuts(lo + middle.first, lo + middle.second);
+            if (n < middle.first) hi = lo + middle.first;
+            else if (n >= middle.second) lo += middle.second;
+            else break;
+        }
+        return data_[k];
+    }
+
+private:
+    // Inserts cuts a <= b, both inside the segment of the last query
+    void addCuts(size_t a, size_t b)
+    {
+        const auto i = std::lower_bound(cuts_.begin(), cuts_.end(), a);
+        if (*i != a) cuts_.insert(i, a);
+        if (b == a) return;
+        const auto j = std::lower_bound(cuts_.begin(), cuts_.end(), b);
+        if (*j != b) cuts_.insert(j, b);
+    }
+
+    T* data_;
+    size_t length_;
+    Compare less_;
+    std::vector<size_t> cuts_;
+};
@@ -0,0 +1,75 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+// Replays streams of 1, 10, 100, and 1000 rank queries, drawn uniformly at
+// random, against one copy of a dataset file, answering them with one
+// adaptiveQuickselect call per query on the same buffer, with a
+// SelectionIndex, and with std::sort followed by lookups. Prints milliseconds
+// per stream.
+
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "selection_index.h"
+using namespace std;
+
+const size_t epochs = 6;
+const size_t outlierEpochs = 1;
+
+int main(int argc, char** argv)
+{
+    if (argc != 2) return 1;
+
+    vector<double> data;
+    if (const auto rc = loadDataset(argv[1], data)) return rc;
+
+    auto sorted = data;
+    sort(sorted.begin(), sorted.end());
+    bool ok = true;
+    mt19937 rng(42);
+    uniform_int_distribution<size_t> ranks(0, data.size() - 1);
+    for (size_t queries : { 1, 10, 100, 1000 })
+    {
+        vector<size_t> ks(queries);
+        vector<double> out(queries), expected(queries);
+        for (size_t i = 0; i < queries; ++i)
+        {
+            ks[i] = ranks(rng);
+            expected[i] = sorted[ks[i]];
+        }
+        // Each epoch answers the queries on a fresh copy of data
+        vector<double> work;
+        const auto prepare = [&]
+        {
+            work = data;
+            fill(out.begin(), out.end(), 0.0);
+        };
+        const auto check = [&] { ok = ok && out == expected; };
+
+        printf("quickselect_%zu: %g\n", queries, measure(prepare, [&]
+            {
+                for (size_t i = 0; i < queries; ++i)
+                {
+                    adaptiveQuickselect(work.data(), ks[i], work.size());
+                    out[i] = work[ks[i]];
+                }
+            }, check, epochs, outlierEpochs));
+        printf("index_%zu: %g\n", queries, measure(prepare, [&]
+            {
+                SelectionIndex<double> index(work.data(), work.size());
+                for (size_t i = 0; i < queries; ++i)
+                    out[i] = index.select(ks[i]);
+            }, check, epochs, outlierEpochs));
+        printf("sort_%zu: %g\n", queries, measure(prepare, [&]
+            {
+                sort(work.begin(), work.end());
+                for (size_t i = 0; i < queries; ++i)
+                    out[i] = work[ks[i]];
+            }, check, epochs, outlierEpochs));
+    }
+    return ok ? 0 : 8;
+}
@@ -0,0 +1,442 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include "common.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SIMD_PARTITION_X86
+#include <immintrin.h>
+#endif
+
+/**
+Partitions r[0 .. length] around the value pivot and returns the size of the
+left side, such that r[0 .. result] <= pivot <= r[result .. length]. Elements
+equal to pivot stop both scans and get swapped, so they end up on either side,
+which keeps the split balanced on inputs with many duplicates.
+*/
+template <class T>
+size_t partitionScalar(T* r, size_t length, const T pivot)
+{
+    size_t lo = 0, hi = length;
+    for (;;)
+    {
+        while (lo < hi && r[lo] < pivot) ++lo;
+        while (lo < hi && pivot < r[hi - 1]) --hi;
+        if (lo >= hi) return lo;
+        // r[lo] >= pivot >= r[hi - 1], swap & make progress
+        --hi;
+        std::swap(r[lo], r[hi]);
+        ++lo;
+    }
+}
+
+/**
+Instruction sets for which there are vectorized partition kernels, in
+increasing order of preference.
+*/
+enum class SimdLevel { none, avx2, avx512 };
+
+inline const char* simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::avx512: return "avx512";
+    case SimdLevel::avx2: return "avx2";
+    default: return "none";
+    }
+}
+
+/**
+Returns the best instruction set supported by the host (as reported by CPUID).
+Setting the environment variable SIMD_PARTITION to "none" or "avx2" caps the
+level, which is useful for comparing kernels on the same machine.
+*/
+inline SimdLevel simdLevel()
+{
+    static const SimdLevel level = []
+    {
+        auto result = SimdLevel::none;
+#ifdef SIMD_PARTITION_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) result = SimdLevel::avx512;
+        else if (__builtin_cpu_supports("avx2")) result = SimdLevel::avx2;
+#endif
+        if (auto cap = getenv("SIMD_PARTITION"))
+        {
+            if (strcmp(cap, "none") == 0) result = SimdLevel::none;
+            else if (strcmp(cap, "avx2") == 0 && result > SimdLevel::avx2)
+                result = SimdLevel::avx2;
+        }
+        return result;
+    }();
+    return level;
+}
+
+#ifdef SIMD_PARTITION_X86
+
+/**
+Permutation indices (in 32-bit units, as expected by _mm256_permutevar8x32)
+that move the lanes whose bit is set in the mask to the front, followed by the
+others. Used by the AVX2 kernels, which lack a compress instruction.
+*/
+template <unsigned lanes>
+struct CompressTable
+{
+    int32_t index[1u << lanes][8];
+};
+
+template <unsigned lanes>
+constexpr CompressTable<lanes> makeCompressTable()
+{
+    CompressTable<lanes> result {};
+    constexpr unsigned width = 8 / lanes;
+    for (unsigned mask = 0; mask < (1u << lanes); ++mask)
+    {
+        unsigned j = 0;
+        for (unsigned pass = 0; pass < 2; ++pass)
+            for (unsigned lane = 0; lane < lanes; ++lane)
+            {
+                if (((mask >> lane) & 1) == pass) continue;
+                for (unsigned k = 0; k < width; ++k)
+                    result.index[mask][j++] = lane * width + k;
+            }
+    }
+    return result;
+}
+
+constexpr auto compressTable4 = makeCompressTable<4>();
+constexpr auto compressTable8 = makeCompressTable<8>();
+
+#pragma GCC push_options
+#pragma GCC target("avx2,popcnt")
+namespace avx2
+{
+
+template <unsigned lanes>
+inline __m256i compress(__m256i v, const CompressTable<lanes>& table,
+    unsigned mask)
+{
+    const auto index = _mm256_loadu_si256((const __m256i*) table.index[mask]);
+    return _mm256_permutevar8x32_epi32(v, index);
+}
+
+/**
+Vector traits. leftMask returns the lanes that go to the left side: those less
+than the pivot, plus every other lane equal to it. split writes those lanes
+starting at left and the others ending at rightEnd. It may write garbage over
+up to a vector's worth of elements past left and before rightEnd.
+*/
+template <class T> struct Vec;
+
+template <> struct Vec<double>
+{
+    using Vector = __m256d;
+    static const size_t lanes = 4;
+    static Vector load(const double* p) { return _mm256_loadu_pd(p); }
+    static Vector broadcast(double x) { return _mm256_set1_pd(x); }
+    static unsigned leftMask(Vector v, Vector p)
+    {
+        const unsigned lt = _mm256_movemask_pd(_mm256_cmp_pd(v, p, _CMP_LT_OQ)),
+            eq = _mm256_movemask_pd(_mm256_cmp_pd(v, p, _CMP_EQ_OQ));
+        return lt | (eq & 0x5);
+    }
+    static void split(double* left, double* rightEnd, Vector v, unsigned mask)
+    {
+        const auto c = _mm256_castsi256_pd(
+            compress(_mm256_castpd_si256(v), compressTable4, mask));
+        _mm256_storeu_pd(left, c);
+        _mm256_storeu_pd(rightEnd - lanes, c);
+    }
+};
+
+template <> struct Vec<float>
+{
+    using Vector = __m256;
+    static const size_t lanes = 8;
+    static Vector load(const float* p) { return _mm256_loadu_ps(p); }
+    static Vector broadcast(float x) { return _mm256_set1_ps(x); }
+    static unsigned leftMask(Vector v, Vector p)
+    {
+        const unsigned lt = _mm256_movemask_ps(_mm256_cmp_ps(v, p, _CMP_LT_OQ)),
+            eq = _mm256_movemask_ps(_mm256_cmp_ps(v, p, _CMP_EQ_OQ));
+        return lt | (eq & 0x55);
+    }
+    static void split(float* left, float* rightEnd, Vector v, unsigned mask)
+    {
+        const auto c = _mm256_castsi256_ps(
+            compress(_mm256_castps_si256(v), compressTable8, mask));
+        _mm256_storeu_ps(left, c);
+        _mm256_storeu_ps(rightEnd - lanes, c);
+    }
+};
+
+template <> struct Vec<int32_t>
+{
+    using Vector = __m256i;
+    static const size_t lanes = 8;
+    static Vector load(const int32_t* p)
+    {
+        return _mm256_loadu_si256((const __m256i*) p);
+    }
+    static Vector broadcast(int32_t x) { return _mm256_set1_epi32(x); }
+    static unsigned leftMask(Vector v, Vector p)
+    {
+        const unsigned lt = _mm256_movemask_ps(
+                _mm256_castsi256_ps(_mm256_cmpgt_epi32(p, v))),
+            eq = _mm256_movemask_ps(
+                _mm256_castsi256_ps(_mm256_cmpeq_epi32(p, v)));
+        return lt | (eq & 0x55);
+    }
+    static void split(int32_t* left, int32_t* rightEnd, Vector v,
+        unsigned mask)
+    {
+        const auto c = compress(v, compressTable8, mask);
+        _mm256_storeu_si256((__m256i*) left, c);
+        _mm256_storeu_si256((__m256i*) (rightEnd - lanes), c);
+    }
+};
+
+template <> struct Vec<int64_t>
+{
+    using Vector = __m256i;
+    static const size_t lanes = 4;
+    static Vector load(const int64_t* p)
+    {
+        return _mm256_loadu_si256((const __m256i*) p);
+    }
+    static Vector broadcast(int64_t x) { return _mm256_set1_epi64x(x); }
+    static unsigned leftMask(Vector v, Vector p)
+    {
+        const unsigned lt = _mm256_movemask_pd(
+                _mm256_castsi256_pd(_mm256_cmpgt_epi64(p, v))),
+            eq = _mm256_movemask_pd(
+                _mm256_castsi256_pd(_mm256_cmpeq_epi64(p, v)));
+        return lt | (eq & 0x5);
+    }
+    static void split(int64_t* left, int64_t* rightEnd, Vector v,
+        unsigned mask)
+    {
+        const auto c = compress(v, compressTable4, mask);
+        _mm256_storeu_si256((__m256i*) left, c);
+        _mm256_storeu_si256((__m256i*) (rightEnd - lanes), c);
+    }
+};
+
+#include "simd_partition_kernel.h"
+
+} // namespace avx2
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,popcnt")
+namespace avx512
+{
+
+/**
+Vector traits, same as for avx2. Compress stores write exactly the lanes
+selected.
+*/
+template <class T> struct Vec;
+
+template <> struct Vec<double>
+{
+    using Vector = __m512d;
+    static const size_t lanes = 8;
+    static Vector load(const double* p) { return _mm512_loadu_pd(p); }
+    static Vector broadcast(double x) { return _mm512_set1_pd(x); }
+    static unsigned leftMask(Vector v, Vector p)
+    {
+        return _mm512_cmp_pd_mask(v, p, _CMP_LT_OQ)
+            | (_mm512_cmp_pd_mask(v, p, _CMP_EQ_OQ) & 0x55);
+    }
+    static void split(double* left, double* rightEnd, Vector v, unsigned mask)
+    {
+        _mm512_mask_compressstoreu_pd(left, mask, v);
+        _mm512_mask_compressstoreu_pd(
+            rightEnd - (lanes - _mm_popcnt_u32(mask)), ~mask, v);
+    }
+};
+
+template <> struct Vec<float>
+{
+    using Vector = __m512;
+    static const size_t lanes = 16;
+    static Vector load(const float* p) { return _mm512_loadu_ps(p); }
+    static Vector broadcast(float x) { return _mm512_set1_ps(x); }
+    static unsigned leftMask(Vector v, Vector p)
+    {
+        return _mm512_cmp_ps_mask(v, p, _CMP_LT_OQ)
+            | (_mm512_cmp_ps_mask(v, p, _CMP_EQ_OQ) & 0x5555);
+    }
+    static void split(float* left, float* rightEnd, Vector v, unsigned mask)
+    {
+        _mm512_mask_compressstoreu_ps(left, mask, v);
+        _mm512_mask_compressstoreu_ps(
+            rightEnd - (lanes - _mm_popcnt_u32(mask)), ~mask, v);
+    }
+};
+
+template <> struct Vec<int32_t>
+{
+    using Vector = __m512i;
+    static const size_t lanes = 16;
+    static Vector load(const int32_t* p) { return _mm512_loadu_si512(p); }
+    static Vector broadcast(int32_t x) { return _mm512_set1_epi32(x); }
+    static unsigned leftMask(Vector v, Vector p)
+    {
+        return _mm512_cmplt_epi32_mask(v, p)
+            | (_mm512_cmpeq_epi32_mask(v, p) & 0x5555);
+    }
+    static void split(int32_t* left, int32_t* rightEnd, Vector v,
+        unsigned mask)
+    {
+        _mm512_mask_compressstoreu_epi32(left, mask, v);
+        _mm512_mask_compressstoreu_epi32(
+            rightEnd - (lanes - _mm_popcnt_u32(mask)), ~mask, v);
+    }
+};
+
+template <> struct Vec<int64_t>
+{
+    using Vector = __m512i;
+    static const size_t lanes = 8;
+    static Vector load(const int64_t* p) { return _mm512_loadu_si512(p); }
+    static Vector broadcast(int64_t x) { return _mm512_set1_epi64(x); }
+    static unsigned leftMask(Vector v, Vector p)
+    {
+        return _mm512_cmplt_epi64_mask(v, p)
+            | (_mm512_cmpeq_epi64_mask(v, p) & 0x55);
+    }
+    static void split(int64_t* left, int64_t* rightEnd, Vector v,
+        unsigned mask)
+    {
+        _mm512_mask_compressstoreu_epi64(left, mask, v);
+        _mm512_mask_compressstoreu_epi64(
+            rightEnd - (lanes - _mm_popcnt_u32(mask)), ~mask, v);
+    }
+};
+
+#include "simd_partition_kernel.h"
+
+} // namespace avx512
+#pragma GCC pop_options
+
+#endif // SIMD_PARTITION_X86
+
+/**
+Key types that have vectorized partition kernels.
+*/
+template <class T> struct HasSimdPartition : std::false_type {};
+template <> struct HasSimdPartition<double> : std::true_type {};
+template <> struct HasSimdPartition<float> : std::true_type {};
+template <> struct HasSimdPartition<int32_t> : std::true_type {};
+template <> struct HasSimdPartition<int64_t> : std::true_type {};
+
+/**
+Whether partitioning through iterator It with comparator Compare can use the
+kernels: It must be a pointer to a type with kernels, compared by operator<.
+*/
+template <class It, class Compare>
+struct UsesSimdPartition : std::false_type {};
+template <class T>
+struct UsesSimdPartition<T*, std::less<>> : HasSimdPartition<T> {};
+template <class T>
+struct UsesSimdPartition<T*, std::less<T>> : HasSimdPartition<T> {};
+
+/**
+Same as partitionScalar, using the best kernel for the host. Each element is
+accounted for as one comparison. The kernels move elements rather than swap
+them; each element greater than pivot that started out left of the split is
+accounted for as one swap, as many as a Hoare partition would make.
+*/
+template <class T>
+size_t simdPartition(T* r, size_t length, const T pivot)
+{
+    static_assert(HasSimdPartition<T>::value, "No SIMD kernel for this type");
+#ifdef COUNT_COMPARISONS
+    g_comparisons += length;
+#endif
+#ifdef COUNT_SWAPS
+    const std::vector<T> before(r, r + length);
+#endif
+    size_t result;
+    switch (simdLevel())
+    {
+#ifdef SIMD_PARTITION_X86
+    case SimdLevel::avx512: result = avx512::partition(r, length, pivot); break;
+    case SimdLevel::avx2: result = avx2::partition(r, length, pivot); break;
+#endif
+    default: result = partitionScalar(r, length, pivot); break;
+    }
+#ifdef COUNT_SWAPS
+    for (size_t i = 0; i < result; ++i) g_swaps += pivot < before[i];
+#endif
+    return result;
+}
+
+/**
+Same as expandPartition, but vectorized. Falls back to expandPartitionBlock for
+types and comparators without kernels, and on hosts without the needed
+instruction sets.
+*/
+template <class It, class Compare>
+size_t expandPartitionSimd(It r, size_t lo, size_t pivot, size_t hi,
+    size_t length, Compare less, std::false_type)
+{
+    return expandPartitionBlock(r, lo, pivot, hi, length, less);
+}
+
+template <class T, class Compare>
+size_t expandPartitionSimd(T* r, size_t lo, size_t pivot, size_t hi,
+    size_t length, Compare less, std::true_type)
+{
+    assert(lo <= pivot && pivot < hi && hi <= length);
+    if (simdLevel() == SimdLevel::none)
+        return expandPartitionBlock(r, lo, pivot, hi, length, less);
+    const auto p = r[pivot];
+    // Partition each side that needs work. Then r[lo - right .. lo] belong to
+    // the right of the pivot and r[hi .. hi + left] to its left.
+    const size_t right = lo > 0 ? lo - simdPartition(r, lo, p) : 0;
+    const size_t left = hi < length ? simdPartition(r + hi, length - hi, p) : 0;
+    // Swap as many as possible across, leaving misplaced elements on one side
+    // only, next to the band.
+    const auto across = std::min(left, right);
+    for (size_t i = 0; i < across; ++i)
+        cswap(r[lo - right + i], r[hi + left - 1 - i]);
+    if (left > across)
+    {
+        // Swap the rest of r[hi .. length]'s left side over to the left of
+        // the pivot.
+        const auto rest = left - across;
+        const auto m = std::min(hi - pivot - 1, rest);
+        for (size_t i = 0; i < m; ++i)
+            cswap(r[pivot + 1 + i], r[hi + rest - 1 - i]);
+        cswap(r[pivot], r[pivot + rest]);
+        return pivot + rest;
+    }
+    // Swap the rest of r[0 .. lo]'s right side over to the right of the
+    // pivot.
+    const auto rest = right - across;
+    const auto m = std::min(rest, pivot - lo);
+    for (size_t i = 0; i < m; ++i)
+        cswap(r[lo - rest + i], r[pivot - 1 - i]);
+    cswap(r[pivot], r[pivot - rest]);
+    return pivot - rest;
+}
+
+template <class It, class Compare = std::less<>>
+size_t expandPartitionSimd(It r, size_t lo, size_t pivot, size_t hi,
+    size_t length, Compare less = Compare())
+{
+    return expandPartitionSimd(r, lo, pivot, hi, length, less,
+        UsesSimdPartition<It, Compare>());
+}
@@ -0,0 +1,72 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+// No include guard: simd_partition.h includes this once per instruction set,
+// inside that instruction set's namespace and #pragma GCC target region. It
+// expects a Vec<T> traits template to be in scope.
+
+/**
+Vectorized in-place partition with the same contract as partitionScalar.
+Loads one vector from each end up front to make room, then repeatedly loads a
+vector from the side with less room and writes its lanes to both sides. The
+side chosen always has room for a full vector of garbage, so stores need not
+be exact.
+*/
+template <class T>
+size_t partition(T* r, size_t length, const T pivot)
+{
+    using V = Vec<T>;
+    const size_t N = V::lanes;
+    if (length < 2 * N) return partitionScalar(r, length, pivot);
+
+    const auto p = V::broadcast(pivot);
+    const auto first = V::load(r), last = V::load(r + length - N);
+    size_t readL = N, readR = length - N, writeL = 0, writeR = length;
+    while (readR - readL >= N)
+    {
+        typename V::Vector v;
+        if (readL - writeL <= writeR - readR)
+        {
+            v = V::load(r + readL);
+            readL += N;
+        }
+        else
+        {
+            readR -= N;
+            v = V::load(r + readR);
+        }
+        const auto mask = V::leftMask(v, p);
+        V::split(r + writeL, r + writeR, v, mask);
+        const size_t n = __builtin_popcount(mask);
+        writeL += n;
+        writeR -= N - n;
+    }
+
+    // Fewer than N elements remain unread, do them one at a time
+    T rest[N];
+    const size_t restLength = readR - readL;
+    std::copy(r + readL, r + readR, rest);
+    for (size_t i = 0; i < restLength; ++i)
+    {
+        if (rest[i] < pivot || (!(pivot < rest[i]) && (i & 1)))
+            r[writeL++] = rest[i];
+        else
+            r[--writeR] = rest[i];
+    }
+
+    // Exactly 2 * N slots are left for the two vectors loaded up front
+    assert(writeR - writeL == 2 * N);
+    auto mask = V::leftMask(first, p);
+    V::split(r + writeL, r + writeR, first, mask);
+    size_t n = __builtin_popcount(mask);
+    writeL += n;
+    writeR -= N - n;
+    mask = V::leftMask(last, p);
+    V::split(r + writeL, r + writeR, last, mask);
+    n = __builtin_popcount(mask);
+    writeL += n;
+    return writeL;
+}
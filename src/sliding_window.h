@@ -0,0 +1,170 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include "common.h"
+#include <cmath>
+#include <vector>
+
+/**
+Multiset kept in order as a sequence of sorted blocks, each of at most twice
+blockSize elements. Adding or removing an element finds its block by binary
+search over the blocks' last elements and shifts at most one block, so both
+cost O(log length + blockSize + length / blockSize) moves and comparisons.
+Finding the element of rank k walks the block sizes in O(length / blockSize).
+With blockSize near sqrt(length), every operation is O(sqrt(length)) and
+touches few cache lines.
+*/
+template <class T, class Compare = std::less<>>
+class SortedBlocks
+{
+public:
+    explicit SortedBlocks(size_t blockSize, Compare less = Compare())
+        : blockSize_(std::max(blockSize, size_t(2))), less_(less)
+    {
+    }
+
+    size_t size() const { return size_; }
+
+    /** Adds x after any elements equivalent to it. */
+    void insert(const T& x)
+    {
+        ++size_;
+        if (blocks_.empty())
+        {
+            blocks_.emplace_back(1, x);
+            return;
+        }
+        const size_t b = std::min(findBlock(x), blocks_.size() - 1);
+        auto& block = blocks_[b];
+        block.insert(std::upper_bound(block.begin(), block.end(), x, less_),
+            x);
+        if (block.size() > 2 * blockSize_)
+        {
+            // Split in halves
+            std::vector<T> upper(block.begin() + blockSize_, block.end());
+            block.resize(blockSize_);
+            blocks_.insert(blocks_.begin() + b + 1, std::move(upper));
+        }
+    }
+
+    /**
+    Removes an element equivalent to x, which must be present.
+    */
+    void erase(const T& x)
+    {
+        const size_t b = findBlock(x);
+        assert(b < blocks_.size());
+        auto& block = blocks_[b];
+        const auto i = std::lower_bound(block.begin(), block.end(), x,
+            less_);
+        assert(i != block.end() && !less_(x, *i));
+        block.erase(i);
+        --size_;
+        if (block.size() * 2 >= blockSize_) return;
+        // Merge small blocks into a neighbor that has room, so the number of
+        // blocks stays within about 2 * length / blockSize
+        if (block.empty())
+        {
+            blocks_.erase(blocks_.begin() + b);
+            return;
+        }
+        const size_t n = b + 1 < blocks_.size() ? b + 1 : b - (b > 0);
+        if (n == b || block.size() + blocks_[n].size() > 2 * blockSize_)
+            return;
+        const size_t lo = std::min(b, n);
+        auto& first = blocks_[lo];
+        auto& second = blocks_[lo + 1];
+        first.insert(first.end(), second.begin(), second.end());
+        blocks_.erase(blocks_.begin() + lo + 1);
+    }
+
+    /** Returns the element of rank k, as if all elements were sorted. */
+    const T& operator[](size_t k) const
+    {
+        assert(k < size_);
+        for (const auto& block : blocks_)
+        {
+            if (k < block.size()) return block[k];
+            k -= block.size();
+        }
+        assert(false);
+        return blocks_.back().back();
+    }
+
+private:
+    // Index of the first block whose last element is not less than x, or the
+    // number of blocks if there is none
+    size_t findBlock(const T& x)
+    {
+        size_t lo = 0, hi = blocks_.size();
+        while (lo < hi)
+        {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (less_(blocks_[mid].back(), x)) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    std::vector<std::vector<T>> blocks_;
+    size_t blockSize_, size_ = 0;
+    Compare less_;
+};
+
+/**
+Order statistics over the most recent samples of a stream: push adds a
+sample, evicting the oldest once window samples are held, and select and
+quantile query the current ones. Each push and query costs O(sqrt(window))
+instead of the O(window) of copying the window and selecting in the copy.
+*/
+template <class T, class Compare = std::less<>>
+class SlidingWindow
+{
+public:
+    explicit SlidingWindow(size_t window, Compare less = Compare())
+        : window_(window),
+          sorted_(size_t(std::sqrt(double(window))), less)
+    {
+        assert(window > 0);
+        ring_.reserve(window);
+    }
+
+    size_t size() const { return ring_.size(); }
+
+    void push(const T& x)
+    {
+        if (ring_.size() < window_)
+        {
+            ring_.push_back(x);
+        }
+        else
+        {
+            sorted_.erase(ring_[next_]);
+            ring_[next_] = x;
+            if (++next_ == window_) next_ = 0;
+        }
+        sorted_.insert(x);
+    }
+
+    /** Returns the sample of rank k among the current ones. */
+    const T& select(size_t k) const { return sorted_[k]; }
+
+    /**
+    Returns the sample of rank q * (size() - 1), rounded down, for q in
+    [0, 1]; q = 0.5 gives the lower median.
+    */
+    const T& quantile(double q) const
+    {
+        assert(q >= 0 && q <= 1 && size() > 0);
+        return sorted_[size_t(q * (size() - 1))];
+    }
+
+private:
+    size_t window_, next_ = 0;
+    std::vector<T> ring_;
+    SortedBlocks<T, Compare> sorted_;
+};
@@ -0,0 +1,74 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+// Replays a dataset file as a stream and takes the median of the most recent
+// window samples after every step samples, optionally stopping after a given
+// number of steps:
+//
+//     sliding_window_bench file.dat window step [steps]
+//
+// Times SlidingWindow over the whole replay, and copying the window and
+// running adaptiveQuickselect on the copy at up to 1000 of the steps spread
+// evenly; the two must agree there. Prints microseconds per step for both.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "bench.h"
+#include "median_of_ninthers.h"
+#include "sliding_window.h"
+using namespace std;
+
+const size_t recomputedSteps = 1000;
+
+int main(int argc, char** argv)
+{
+    if (argc != 4 && argc != 5) return 1;
+    const size_t window = strtoull(argv[2], nullptr, 10),
+        step = strtoull(argv[3], nullptr, 10),
+        maxSteps = argc == 5 ? strtoull(argv[4], nullptr, 10) : SIZE_MAX;
+    if (window == 0 || step == 0) return 1;
+
+    vector<double> data;
+    if (const auto rc = loadDataset(argv[1], data)) return rc;
+    if (data.size() < window) return 7;
+
+    // Steps end at window, window + step, window + 2 * step, ...
+    const size_t steps = min((data.size() - window) / step + 1, maxSteps);
+    vector<double> medians(steps);
+    SlidingWindow<double> sliding(window);
+    Timer t;
+    size_t pushed = 0;
+    for (size_t i = 0; i < steps; ++i)
+    {
+        for (const size_t end = window + i * step; pushed < end; ++pushed)
+            sliding.push(data[pushed]);
+        medians[i] = sliding.quantile(0.5);
+    }
+    const double slidingTime = t.elapsed();
+
+    // Recompute at some of the steps
+    const size_t stride = max(steps / recomputedSteps, size_t(1));
+    const size_t n = (window - 1) / 2;
+    vector<double> buf;
+    bool ok = true;
+    size_t recomputed = 0;
+    double recomputeTime = 0;
+    for (size_t i = 0; i < steps; i += stride, ++recomputed)
+    {
+        const auto first = data.begin() + i * step;
+        Timer t;
+        buf.assign(first, first + window);
+        adaptiveQuickselect(buf.data(), n, window);
+        recomputeTime += t.elapsed();
+        ok = ok && buf[n] == medians[i];
+    }
+
+    printf("window: %zu\nstep: %zu\nsteps: %zu\n", window, step, steps);
+    printf("sliding_us: %g\n", slidingTime * 1000 / steps);
+    printf("recompute_us: %g\n", recomputeTime * 1000 / recomputed);
+    return ok ? 0 : 8;
+}
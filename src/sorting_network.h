@@ -0,0 +1,191 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/**
+Longest arrays for which networks are generated.
+*/
+const size_t maxNetworkLength = 64;
+
+/**
+Comparator of a network: moves the smaller of wires lo < hi to lo and the
+larger to hi. Bit 0 of outputs is set if later steps (or the result) use wire
+lo, bit 1 if they use wire hi; a step may compute only the outputs used.
+*/
+struct NetworkStep
+{
+    uint8_t lo, hi, outputs;
+};
+
+/**
+Comparators of Batcher's odd-even merge sort for 64 wires, the most of any
+network here.
+*/
+const size_t maxNetworkSteps = 543;
+
+/**
+Comparator network over length wires, applied in order.
+*/
+struct Network
+{
+    size_t length = 0, size = 0;
+    NetworkStep steps[maxNetworkSteps] = {};
+};
+
+/**
+Generates Batcher's odd-even merge sort network for length wires. It has no
+branches, so it can run on many arrays at once, one per vector lane.
+*/
+constexpr Network makeSortingNetwork(size_t length)
+{
+    assert(length <= maxNetworkLength);
+    Network result {};
+    result.length = length;
+    for (size_t p = 1; p < length; p <<= 1)
+        for (size_t k = p; k >= 1; k >>= 1)
+            for (size_t j = k % p; j + k < length; j += 2 * k)
+                for (size_t i = 0; i < k && i + j + k < length; ++i)
+                    if ((i + j) / (2 * p) == (i + j + k) / (2 * p))
+                        result.steps[result.size++] = { uint8_t(i + j),
+                            uint8_t(i + j + k), 3 };
+    return result;
+}
+
+/**
+Prunes the sorting network for length wires to the comparators that wire n
+depends on, and marks those of which only one output is used. Applying the
+result places on wire n the element of rank n; the other wires are left in
+no particular order.
+*/
+constexpr Network makeSelectionNetwork(size_t length, size_t n)
+{
+    assert(n < length);
+    const auto sorting = makeSortingNetwork(length);
+    Network result {};
+    result.length = length;
+    // Walk back from the output, keeping the comparators that feed a wire
+    // still in use
+    uint64_t live = uint64_t(1) << n;
+    for (size_t i = sorting.size; i-- > 0; )
+    {
+        const auto s = sorting.steps[i];
+        const unsigned outputs = unsigned(live >> s.lo & 1)
+            | unsigned(live >> s.hi & 1) << 1;
+        if (outputs == 0) continue;
+        result.steps[result.size++] = { s.lo, s.hi, uint8_t(outputs) };
+        live |= uint64_t(1) << s.lo | uint64_t(1) << s.hi;
+    }
+    for (size_t i = 0, j = result.size; i + 1 < j; ++i, --j)
+    {
+        const auto t = result.steps[i];
+        result.steps[i] = result.steps[j - 1];
+        result.steps[j - 1] = t;
+    }
+    return result;
+}
+
+template <size_t... lengths>
+constexpr std::array<Network, sizeof...(lengths)> makeSortingNetworks(
+    std::index_sequence<lengths...>)
+{
+    return {{ makeSortingNetwork(lengths)... }};
+}
+
+/**
+sortingNetworks[length] sorts arrays of length elements.
+*/
+constexpr auto sortingNetworks =
+    makeSortingNetworks(std::make_index_sequence<maxNetworkLength + 1>());
+
+/**
+Prunes the sorting network for length wires to a network that partitions
+around rank n: it places on wire n the element of rank n, and the elements
+no greater than it on the wires below. Walking back from the outputs, the
+wires below n only matter as a set, and so do those above n, so a comparator
+between two wires of the same set can go; the wires of the comparators that
+stay matter individually from then on.
+*/
+constexpr Network makePartitionNetwork(size_t length, size_t n)
+{
+    assert(n < length);
+    const auto sorting = makeSortingNetwork(length);
+    Network result {};
+    result.length = length;
+    enum : uint8_t { below, exact, above };
+    uint8_t wire[maxNetworkLength] = {};
+    for (size_t i = 0; i < length; ++i)
+        wire[i] = i < n ? below : i == n ? exact : above;
+    for (size_t i = sorting.size; i-- > 0; )
+    {
+        const auto s = sorting.steps[i];
+        if (wire[s.lo] == wire[s.hi] && wire[s.lo] != exact) continue;
+        result.steps[result.size++] = s;
+        wire[s.lo] = wire[s.hi] = exact;
+    }
+    for (size_t i = 0, j = result.size; i + 1 < j; ++i, --j)
+    {
+        const auto t = result.steps[i];
+        result.steps[i] = result.steps[j - 1];
+        result.steps[j - 1] = t;
+    }
+    return result;
+}
+
+/**
+Arrays at most this long have partition networks for every rank generated at
+compile time, in partitionNetworks.
+*/
+const size_t maxPartitionNetworkLength = 32;
+
+constexpr size_t partitionNetworkSteps()
+{
+    size_t result = 0;
+    for (size_t length = 1; length <= maxPartitionNetworkLength; ++length)
+        for (size_t n = 0; n < length; ++n)
+            result += makePartitionNetwork(length, n).size;
+    return result;
+}
+
+/**
+All partition networks for up to maxPartitionNetworkLength wires, stored
+back to back: the one for length and n is steps[first[length][n] ..
+first[length][n + 1]].
+*/
+template <size_t size>
+struct PartitionNetworks
+{
+    uint16_t first[maxPartitionNetworkLength + 1]
+        [maxPartitionNetworkLength + 1] = {};
+    NetworkStep steps[size] = {};
+};
+
+template <size_t size>
+constexpr PartitionNetworks<size> makePartitionNetworks()
+{
+    PartitionNetworks<size> result {};
+    size_t k = 0;
+    for (size_t length = 1; length <= maxPartitionNetworkLength; ++length)
+    {
+        for (size_t n = 0; n < length; ++n)
+        {
+            result.first[length][n] = uint16_t(k);
+            const auto network = makePartitionNetwork(length, n);
+            for (size_t i = 0; i < network.size; ++i)
+                result.steps[k++] = network.steps[i];
+        }
+        result.first[length][length] = uint16_t(k);
+    }
+    return result;
+}
+
+constexpr auto partitionNetworks =
+    makePartitionNetworks<partitionNetworkSteps()>();
@@ -0,0 +1,98 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+// Times the recursion tails of selection in isolation: for each length from 2
+// to maxPartitionNetworkLength, cuts a dataset file into consecutive windows
+// of that length and places an element of random rank in each window with
+// std::nth_element, with quickselect over pivotPartition (which
+// adaptiveQuickselect used for ranges of up to 16 elements), and with
+// networkSelect. Prints nanoseconds per window.
+
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "median_of_ninthers.h"
+using namespace std;
+
+// Quickselect with pivotPartition at every step
+void partitionSelect(double* r, size_t n, size_t length)
+{
+    for (;;)
+    {
+        const auto pivot = pivotPartition(r, n, length) - r;
+        if (size_t(pivot) == n) return;
+        if (size_t(pivot) > n)
+        {
+            length = pivot;
+        }
+        else
+        {
+            r += pivot + 1;
+            length -= pivot + 1;
+            n -= pivot + 1;
+        }
+    }
+}
+
+// Average duration of f over the epochs, less the slowest ones, in
+// nanoseconds per window. Each epoch works on a fresh copy of data, and
+// afterwards each window must hold its expected element at its rank.
+template <class F>
+double measureWindows(F f, const vector<double>& data, size_t length,
+    const vector<size_t>& ns, const vector<double>& expected, bool& ok)
+{
+    vector<double> work;
+    return measure([&] { work = data; }, [&]
+        {
+            for (size_t w = 0; w < ns.size(); ++w)
+                f(work.data() + w * length, ns[w], length);
+        }, [&]
+        {
+            for (size_t w = 0; w < ns.size(); ++w)
+                ok = ok && work[w * length + ns[w]] == expected[w];
+        }) * 1e6 / ns.size();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2) return 1;
+
+    vector<double> data;
+    if (const auto rc = loadDataset(argv[1], data)) return rc;
+
+    bool ok = true;
+    mt19937 rng(42);
+    for (size_t length = 2; length <= maxPartitionNetworkLength; ++length)
+    {
+        const size_t windows = data.size() / length;
+        if (windows == 0) break;
+        vector<size_t> ns(windows);
+        vector<double> expected(windows);
+        auto sorted = data;
+        for (size_t w = 0; w < windows; ++w)
+        {
+            ns[w] = rng() % length;
+            const auto r = sorted.begin() + w * length;
+            nth_element(r, r + ns[w], r + length);
+            expected[w] = r[ns[w]];
+        }
+
+        printf("nth_element_%zu: %g\n", length, measureWindows(
+            [](double* r, size_t n, size_t length)
+            {
+                nth_element(r, r + n, r + length);
+            }, data, length, ns, expected, ok));
+        printf("partition_%zu: %g\n", length,
+            measureWindows(&partitionSelect, data, length, ns, expected, ok));
+        printf("network_%zu: %g\n", length, measureWindows(
+            [](double* r, size_t n, size_t length)
+            {
+                networkSelect(r, n, length);
+            }, data, length, ns, expected, ok));
+    }
+    return ok ? 0 : 8;
+}
@@ -0,0 +1,198 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+Fork-join pool for data-parallel loops. parallelFor(tasks, f) calls f(i) for
+each i in [0, tasks) and returns when all calls are done. The calling thread
+participates, so a pool of size 1 spawns no threads and runs everything inline.
+The pool runs one loop at a time: a parallelFor called while another is under
+way, from another thread or from within a task, runs its loop inline on the
+calling thread, so concurrent callers may share a pool.
+
+Scheduling is by work stealing: task indices are dealt to the participants in
+contiguous ranges, each participant consumes its own range from the front, and
+once done it steals from the back of the others' ranges. Each range is a
+(begin, end) pair packed in one atomic word, so both operations are a single
+compare-and-swap.
+*/
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t threads)
+        : slots_(threads > 0 ? threads : 1)
+    {
+        for (size_t i = 1; i < slots_.size(); ++i)
+            workers_.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& w : workers_) w.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /** Number of participating threads, including the caller. */
+    size_t size() const { return slots_.size(); }
+
+    template <class F>
+    void parallelFor(size_t tasks, F&& f)
+    {
+        assert(tasks <= UINT32_MAX);
+        if (tasks == 0) return;
+        if (slots_.size() == 1 || tasks == 1
+            || inUse_.exchange(true, std::memory_order_acquire))
+        {
+            for (size_t i = 0; i < tasks; ++i) f(i);
+            return;
+        }
+        // Deal the tasks in contiguous ranges
+        const auto n = slots_.size();
+        for (size_t i = 0; i < n; ++i)
+            slots_[i].range.store(pack(tasks * i / n, tasks * (i + 1) / n),
+                std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            assert(!body_);
+            body_ = &f;
+            invoke_ = [](void* body, size_t i) { (*static_cast<F*>(body))(i); };
+            busy_ = n - 1;
+            ++generation_;
+        }
+        wake_.notify_all();
+        run(0);
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return busy_ == 0; });
+        body_ = nullptr;
+        inUse_.store(false, std::memory_order_release);
+    }
+
+private:
+    // Padded to a cache line so stealing doesn't cause false sharing
+    struct Slot
+    {
+        std::atomic<uint64_t> range { 0 };
+        char padding[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+    static uint64_t pack(uint64_t begin, uint64_t end)
+    {
+        return begin << 32 | end;
+    }
+
+    // Takes a task from the front of slot s, returns false if it's empty
+    bool pop(size_t s, size_t& task)
+    {
+        auto& range = slots_[s].range;
+        auto r = range.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            const auto begin = r >> 32, end = r & UINT32_MAX;
+            if (begin >= end) return false;
+            if (range.compare_exchange_weak(r, pack(begin + 1, end)))
+            {
+                task = begin;
+                return true;
+            }
+        }
+    }
+
+    // Takes a task from the back of slot s, returns false if it's empty
+    bool steal(size_t s, size_t& task)
+    {
+        auto& range = slots_[s].range;
+        auto r = range.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            const auto begin = r >> 32, end = r & UINT32_MAX;
+            if (begin >= end) return false;
+            if (range.compare_exchange_weak(r, pack(begin, end - 1)))
+            {
+                task = end - 1;
+                return true;
+            }
+        }
+    }
+
+    void run(size_t self)
+    {
+        const auto n = slots_.size();
+        size_t task;
+        for (;;)
+        {
+            if (pop(self, task))
+            {
+                invoke_(body_, task);
+                continue;
+            }
+            bool stolen = false;
+            for (size_t i = 1; i < n && !stolen; ++i)
+                stolen = steal((self + i) % n, task);
+            if (!stolen) return;
+            invoke_(body_, task);
+        }
+    }
+
+    void workerLoop(size_t self)
+    {
+        uint64_t seen = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock,
+                    [&] { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+            }
+            run(self);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--busy_ == 0) done_.notify_one();
+        }
+    }
+
+    std::vector<Slot> slots_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_, done_;
+    void* body_ = nullptr;
+    void (*invoke_)(void*, size_t) = nullptr;
+    size_t busy_ = 0;
+    uint64_t generation_ = 0;
+    bool stop_ = false;
+    std::atomic<bool> inUse_ { false };
+};
+
+/**
+Number of threads to use by default: the value of the environment variable
+SELECTION_THREADS if set, otherwise the number of hardware threads.
+*/
+inline size_t defaultThreadCount()
+{
+    if (auto s = getenv("SELECTION_THREADS"))
+    {
+        const auto n = strtoul(s, nullptr, 10);
+        if (n > 0) return n;
+    }
+    const auto n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
@@ -0,0 +1,163 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+// Measures the throughput of independent median selections running on
+// several threads at once:
+//
+//     throughput_bench [--algo=name] [--threads=N,...] [--seconds=X] file.dat
+//
+// For each thread count (by default the powers of 2 below defaultThreadCount()
+// and that count itself), every thread makes private copies of the dataset,
+// then all threads start together and, until the time is up, restore their
+// working copy with memcpy and select its median with the algorithm given
+// (median_of_ninthers by default), checking the result. A second run of the
+// same length only copies, which gives the memory bandwidth available to that
+// many threads as a reference.
+//
+// Prints one line per thread count: selections per second, the bandwidth of
+// the selection run (counting the restoring copy's read and write and one
+// read of the data by the selection), the bandwidth of the copy-only run, the
+// speedup of selections over the rate per thread of the first thread count,
+// and the efficiency (speedup per thread).
+
+#include "algorithms.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench.h"
+
+using namespace std;
+
+// Totals of one timed run over all threads
+struct Throughput
+{
+    // Operations per second, summed over the threads' own rates
+    double rate = 0;
+    bool failed = false;
+};
+
+// Runs threads threads for the given number of milliseconds, each selecting
+// the median of its copy of data (or, if select is null, only copying it) as
+// many times as it can
+Throughput run(const vector<double>& data, double expected,
+    void (*select)(double*, double*, double*), size_t threads,
+    double milliseconds)
+{
+    const size_t length = data.size(), n = length / 2;
+    atomic<size_t> ready { 0 };
+    atomic<bool> go { false }, failed { false };
+    vector<double> rates(threads);
+    vector<thread> workers;
+    for (size_t i = 0; i < threads; ++i)
+        workers.emplace_back([&, i]
+        {
+            // Allocated and first touched by this thread, so they're local
+            vector<double> source(data), work(length);
+            ++ready;
+            while (!go.load(memory_order_acquire)) this_thread::yield();
+            size_t count = 0;
+            Timer t;
+            double elapsed;
+            do
+            {
+                memcpy(work.data(), source.data(), length * sizeof(double));
+                if (select)
+                {
+                    select(work.data(), work.data() + n,
+                        work.data() + length);
+                    if (work[n] != expected) failed = true;
+                }
+                ++count;
+            } while ((elapsed = t.elapsed()) < milliseconds);
+            rates[i] = count / elapsed * 1000;
+        });
+    while (ready.load() < threads) this_thread::yield();
+    go.store(true, memory_order_release);
+    for (auto& w : workers) w.join();
+
+    Throughput result;
+    for (auto r : rates) result.rate += r;
+    result.failed = failed;
+    return result;
+}
+
+// Parses a comma-separated list of positive numbers, returning false if s
+// isn't one
+bool parseCounts(const char* s, vector<size_t>& result)
+{
+    for (;;)
+    {
+        char* end;
+        const auto n = strtoull(s, &end, 10);
+        if (n == 0 || (*end && *end != ',')) return false;
+        result.push_back(n);
+        if (!*end) return true;
+        s = end + 1;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    string algo = "median_of_ninthers";
+    vector<size_t> threadCounts;
+    double seconds = 1;
+    const char* fname = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--algo=", 7) == 0) algo = arg + 7;
+        else if (strncmp(arg, "--threads=", 10) == 0)
+        {
+            if (!parseCounts(arg + 10, threadCounts)) return 1;
+        }
+        else if (strncmp(arg, "--seconds=", 10) == 0)
+        {
+            seconds = atof(arg + 10);
+            if (!(seconds > 0)) return 1;
+        }
+        else if (strncmp(arg, "--", 2) == 0 || fname) return 1;
+        else fname = arg;
+    }
+    if (!fname) return 1;
+    const auto a = findAlgorithm<double>(algo);
+    if (!a.select) return 1;
+    if (threadCounts.empty())
+    {
+        const auto max = defaultThreadCount();
+        for (size_t t = 1; t < max; t *= 2) threadCounts.push_back(t);
+        threadCounts.push_back(max);
+    }
+
+    vector<double> data;
+    if (const auto rc = loadDataset(fname, data)) return rc;
+
+    auto sorted = data;
+    const size_t length = data.size(), n = length / 2;
+    nth_element(sorted.begin(), sorted.begin() + n, sorted.end());
+    const double expected = sorted[n];
+    const double bytes = length * sizeof(double);
+
+    printf("algorithm: %s\nlength: %zu\n", algo.c_str(), length);
+    printf("threads\tsel/s\tsel GB/s\tcopy GB/s\tspeedup\tefficiency\n");
+    double base = 0;
+    for (auto threads : threadCounts)
+    {
+        const auto s = run(data, expected, a.select, threads, seconds * 1000);
+        if (s.failed) return 8;
+        const auto c = run(data, expected, nullptr, threads, seconds * 1000);
+        if (base == 0) base = s.rate / threads;
+        const auto speedup = s.rate / base;
+        printf("%zu\t%.1f\t%.2f\t%.2f\t%.2f\t%.2f\n", threads, s.rate,
+            s.rate * 3 * bytes / 1e9, c.rate * 2 * bytes / 1e9, speedup,
+            speedup / threads);
+        fflush(stdout);
+    }
+}
@@ -0,0 +1,264 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+// Tunes the thresholds of adaptiveQuickselect (see TuningParameters) for each
+// key type on the host and prints tuning_generated.h with the results:
+//
+//     tune [--reps=N] [--types=name,...] file.dat... >tuning_generated.h
+//
+// Key types are int32, int64, float, and double (the default), made from the
+// datasets as by bench_runner. Starting from defaultTuning, each parameter in
+// turn is set to each of its candidate values, keeping the one that makes
+// selection fastest, until a pass over all parameters changes nothing. A
+// setting is scored by its median time over reps runs of selecting ranks at
+// 10%, 20%, and 50% of every file, relative to that of the setting in effect
+// and averaged over files and ranks. Changes must gain more than 2%, so noise
+// leaves the defaults alone. Progress goes to stderr.
+//
+// Must be compiled with RUNTIME_TUNING defined.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "key_types.h"
+#include "median_of_ninthers.h"
+#include "timer.h"
+
+#ifndef RUNTIME_TUNING
+#error "tune.cpp must be compiled with -DRUNTIME_TUNING"
+#endif
+
+using namespace std;
+
+// A parameter with the values tried for it
+struct Parameter
+{
+    const char* name;
+    size_t TuningParameters::*member;
+    vector<size_t> candidates;
+};
+
+const Parameter parameters[] =
+{
+    { "networkLength", &TuningParameters::networkLength, { 16, 24, 32 } },
+    { "extremeRatio", &TuningParameters::extremeRatio, { 4, 5, 6, 8, 10 } },
+    { "smallFraction", &TuningParameters::smallFraction, { 12, 16, 24 } },
+    { "mediumLength", &TuningParameters::mediumLength,
+        { 512, 1024, 2048, 4096 } },
+    { "mediumFraction", &TuningParameters::mediumFraction,
+        { 32, 64, 128 } },
+    { "largeLength", &TuningParameters::largeLength,
+        { 32 * 1024, 128 * 1024, 512 * 1024 } },
+    { "largeFraction", &TuningParameters::largeFraction,
+        { 256, 512, 1024, 2048 } },
+};
+
+const double rankFractions[] = { 0.1, 0.2, 0.5 };
+
+// Selection must get this much faster for a setting to be adopted
+const double minGain = 0.02;
+
+// Number of doubles in a dataset file, or 0 if it can't be one
+size_t fileLength(const char* path)
+{
+    struct stat stat_buf;
+    if (stat(path, &stat_buf) != 0) return 0;
+    if (stat_buf.st_size % 8 != 0) return 0;
+    return stat_buf.st_size / 8;
+}
+
+void print(FILE* f, const TuningParameters& t)
+{
+    fprintf(f, "{ %zu, %zu, %zu, %zu, %zu, %zu, %zu }", t.smallFraction,
+        t.mediumFraction, t.largeFraction, t.mediumLength, t.largeLength,
+        t.networkLength, t.extremeRatio);
+}
+
+template <class T>
+struct Tuner
+{
+    vector<vector<T>> inputs;
+    vector<T> work;
+    size_t reps;
+
+    // Median duration of each file and rank with the current tuning<T>()
+    vector<double> measure()
+    {
+        vector<double> result, durations(reps);
+        for (const auto& input : inputs)
+        {
+            const size_t length = input.size();
+            for (auto q : rankFractions)
+            {
+                const size_t n = size_t(q * length);
+                for (auto& d : durations)
+                {
+                    memcpy(work.data(), input.data(), length * sizeof(T));
+                    Timer t;
+                    adaptiveQuickselect(work.data(), n, length);
+                    d = t.elapsed();
+                }
+                nth_element(durations.begin(),
+                    durations.begin() + reps / 2, durations.end());
+                result.push_back(durations[reps / 2]);
+            }
+        }
+        return result;
+    }
+
+    // Mean ratio of the durations of tuning t to those given
+    double score(const TuningParameters& t, const vector<double>& reference)
+    {
+        runtimeTuning<T>() = t;
+        const auto durations = measure();
+        double sum = 0;
+        for (size_t i = 0; i < durations.size(); ++i)
+            sum += durations[i] / reference[i];
+        return sum / durations.size();
+    }
+
+    TuningParameters tune()
+    {
+        auto best = defaultTuning;
+        runtimeTuning<T>() = best;
+        auto reference = measure();
+        for (bool changed = true; changed; )
+        {
+            changed = false;
+            for (const auto& p : parameters)
+            {
+                auto bestScore = 1 - minGain;
+                auto choice = best;
+                for (auto value : p.candidates)
+                {
+                    auto t = best;
+                    t.*p.member = value;
+                    if (value == best.*p.member || !validTuning(t)) continue;
+                    const auto s = score(t, reference);
+                    fprintf(stderr, "%s: %s = %zu: %.3f\n",
+                        KeyType<T>::name(), p.name, value, s);
+                    if (s < bestScore) bestScore = s, choice = t;
+                }
+                if (choice.*p.member == best.*p.member) continue;
+                best = choice;
+                changed = true;
+                runtimeTuning<T>() = best;
+                reference = measure();
+            }
+        }
+        fprintf(stderr, "%s: ", KeyType<T>::name());
+        print(stderr, best);
+        fprintf(stderr, "\n");
+        return best;
+    }
+};
+
+// Tunes keys of type T on the files and prints the specialization of Tuning
+// for them. Returns 0 or an exit code.
+template <class T>
+int run(const vector<const char*>& files, size_t reps, const char* typeName)
+{
+    Tuner<T> tuner;
+    tuner.reps = reps;
+    vector<double> raw, distinct;
+    for (auto path : files)
+    {
+        const size_t length = fileLength(path);
+        raw.resize(length);
+        const auto f = fopen(path, "rb");
+        if (!f) return 4;
+        if (fread(raw.data(), sizeof(double), length, f) != length) return 5;
+        if (fclose(f) != 0) return 6;
+        tuner.inputs.emplace_back(length);
+        makeKeys(raw.data(), length, tuner.inputs.back().data(), distinct);
+        if (length > tuner.work.size()) tuner.work.resize(length);
+    }
+    const auto t = tuner.tune();
+    printf("\ntemplate <> struct Tuning<%s>\n{\n"
+        "    static constexpr TuningParameters get()\n    {\n"
+        "        return ", typeName);
+    print(stdout, t);
+    printf(";\n    }\n};\n");
+    return 0;
+}
+
+// Model name of the first processor in /proc/cpuinfo, if any
+string cpuModel()
+{
+    const auto f = fopen("/proc/cpuinfo", "r");
+    if (!f) return "an unknown processor";
+    char line[256];
+    string result = "an unknown processor";
+    while (fgets(line, sizeof(line), f))
+    {
+        if (strncmp(line, "model name", 10) != 0) continue;
+        const char* s = strchr(line, ':');
+        if (!s) continue;
+        for (++s; *s == ' ' || *s == '\t'; ++s) {}
+        result.assign(s, strcspn(s, "\n"));
+        break;
+    }
+    fclose(f);
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    size_t reps = 7;
+    vector<string> types;
+    vector<const char*> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--reps=", 7) == 0)
+        {
+            reps = strtoull(arg + 7, nullptr, 10);
+        }
+        else if (strncmp(arg, "--types=", 8) == 0)
+        {
+            for (const char* s = arg + 8; ; )
+            {
+                const auto end = strchrnul(s, ',');
+                types.emplace_back(s, end);
+                if (!*end) break;
+                s = end + 1;
+            }
+        }
+        else if (strncmp(arg, "--", 2) == 0)
+        {
+            return 1;
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty() || reps == 0) return 1;
+    for (auto path : files)
+        if (fileLength(path) == 0) return 3;
+    if (types.empty()) types.push_back("double");
+    for (const auto& type : types)
+        if (type != "int32" && type != "int64" && type != "float"
+            && type != "double")
+            return 1;
+
+    printf("// Specializations of Tuning for %s, generated by\n"
+        "// `make tune`.\n#pragma once\n#include <cstdint>\n",
+        cpuModel().c_str());
+    for (const auto& type : types)
+    {
+        int rc;
+        if (type == "int32") rc = run<int32_t>(files, reps, "int32_t");
+        else if (type == "int64") rc = run<int64_t>(files, reps, "int64_t");
+        else if (type == "float") rc = run<float>(files, reps, "float");
+        else rc = run<double>(files, reps, "double");
+        if (rc != 0) return rc;
+    }
+}
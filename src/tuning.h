@@ -0,0 +1,119 @@
+/*          Copyright Andrei Alexandrescu, 2016-.
+ * Distributed under the Boost Software License, Version 1.0.
+ *    (See accompanying file LICENSE_1_0.txt or copy at
+ *          https://boost.org/LICENSE_1_0.txt)
+ */
+
+#pragma once
+#include <cstddef>
+#include "sorting_network.h"
+
+/**
+Thresholds of adaptiveQuickselect and the strategies it dispatches to.
+*/
+struct TuningParameters
+{
+    // medianOfNinthers takes the median of length / smallFraction ninthers
+    // on arrays of up to mediumLength elements, of length / mediumFraction on
+    // arrays of up to largeLength, and of length / largeFraction beyond
+    size_t smallFraction, mediumFraction, largeFraction;
+    size_t mediumLength, largeLength;
+    // Ranges of up to networkLength elements are finished by networkSelect
+    size_t networkLength;
+    // Ranks n with n * extremeRatio <= length are found with medianOfMinima,
+    // and symmetrically with medianOfMaxima near the end; the others with
+    // medianOfNinthers or floydRivest
+    size_t extremeRatio;
+};
+
+/**
+Values tuned by hand for double, and the defaults for all types.
+*/
+constexpr TuningParameters defaultTuning =
+{
+    12, 64, 1024, 1024, 128 * 1024, maxPartitionNetworkLength, 6
+};
+
+/**
+Whether the strategies work with t: medianOfNinthers needs at least 12
+elements and nine ninthers' worth of room for each median, each fraction
+must leave at least one ninther, and medianOfMinima and medianOfMaxima need
+the rank within a quarter of the end.
+*/
+constexpr bool validTuning(const TuningParameters& t)
+{
+    return t.networkLength >= 12
+        && t.networkLength <= maxPartitionNetworkLength
+        && t.smallFraction >= 12 && t.smallFraction <= t.networkLength + 1
+        && t.mediumLength >= t.networkLength
+        && t.mediumFraction >= 12 && t.mediumFraction <= t.mediumLength + 1
+        && t.largeLength >= t.mediumLength
+        && t.largeFraction >= 12 && t.largeFraction <= t.largeLength + 1
+        && t.extremeRatio >= 4;
+}
+
+static_assert(validTuning(defaultTuning), "invalid default tuning");
+
+/**
+Parameters for keys of type T. Specializations for the host are generated
+by `make tune` in tuning_generated.h; tuning<T>() checks them with
+validTuning when they are used.
+*/
+template <class T>
+struct Tuning
+{
+    static constexpr TuningParameters get() { return defaultTuning; }
+};
+
+#include "tuning_generated.h"
+
+#ifdef RUNTIME_TUNING
+/**
+With RUNTIME_TUNING defined, as when building the tuner, the parameters are
+read from a variable per type instead, which starts out as Tuning<T>::get().
+*/
+template <class T>
+TuningParameters& runtimeTuning()
+{
+    static_assert(validTuning(Tuning<T>::get()), "invalid tuning");
+    static TuningParameters result = Tuning<T>::get();
+    return result;
+}
+
+template <class T>
+const TuningParameters& tuning()
+{
+    return runtimeTuning<T>();
+}
+#else
+/**
+Parameters in effect for keys of type T.
+*/
+template <class T>
+constexpr TuningParameters tuning()
+{
+    static_assert(validTuning(Tuning<T>::get()), "invalid tuning");
+    return Tuning<T>::get();
+}
+#endif
+
+/**
+Number of ninthers whose median medianOfNinthers takes on length elements.
+*/
+constexpr size_t ninthersFraction(const TuningParameters& t, size_t length)
+{
+    return length <= t.mediumLength ? length / t.smallFraction
+        : length <= t.largeLength ? length / t.mediumFraction
+        : length / t.largeFraction;
+}
+
+/**
+Whether rank n of length elements is far enough from both ends to be found
+with medianOfNinthers or floydRivest rather than medianOfMinima or
+medianOfMaxima.
+*/
+constexpr bool middleRank(const TuningParameters& t, size_t n, size_t length)
+{
+    return n * t.extremeRatio > length
+        && n * t.extremeRatio < length * (t.extremeRatio - 1);
+}
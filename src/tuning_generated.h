@@ -0,0 +1,3 @@
+// Specializations of Tuning for the host CPU, generated by `make tune`. None
+// have been generated, so all key types use defaultTuning.
+#pragma once